@@ -26,7 +26,8 @@ private:
   }
 
   auto OnExit() -> int override {
-    m_console->PowerOff();
+    // the emulation thread has to see this one, or it never exits
+    while (!m_console->Send({nes::Console::Command::Type::PowerOff})) wxMilliSleep(1);
     return 0;
   }
 };
@@ -1,51 +1,241 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
 #include <wx/dcbuffer.h>
+#include <wx/rawbmp.h>
 #include <wx/wx.h>
 
+#include "nes/filter_worker.hpp"
 #include "nes/nes.hpp"
+#include "nes/scaler.hpp"
 
 namespace gui {
 
+// posted to the screen when the console has finished drawing a frame
+inline wxEventTypeTag<wxThreadEvent> const EVT_FRAME_READY{wxNewEventType()};
+
+// Wakes the screen when the filter worker has a new frame, at most once until the screen has taken
+// it. The worker shares ownership and the screen detaches itself when it's destroyed, so the
+// worker thread never touches a screen that's gone.
+struct FrameMailbox {
+  std::mutex mutex;
+  wxEvtHandler* screen = nullptr;
+  bool pending = false;
+
+  void Notify() {
+    std::lock_guard lock{mutex};
+    if (screen == nullptr || pending) return;
+    pending = true;
+    wxQueueEvent(screen, new wxThreadEvent{EVT_FRAME_READY});
+  }
+};
+
+// Repaints only when the console has a new frame (or the window changes size). Each frame goes
+// through the selected video filter on a worker thread, then is scaled up by the largest whole
+// factor that fits, straight into a bitmap kept between frames, and centred on a black
+// background.
 class GameScreen : public wxPanel {
 public:
   GameScreen(wxFrame* parent, nes::Console* console)
-    : wxPanel{parent, wxID_ANY, wxDefaultPosition, {256, 240}} {
+    // wxWANTS_CHARS keeps Tab (held for fast-forward) from being eaten by focus navigation
+    : wxPanel{parent, wxID_ANY, wxDefaultPosition, {256, 240}, wxWANTS_CHARS} {
     SetMinSize({256, 240});
+    SetBackgroundStyle(wxBG_STYLE_PAINT);
 
     Bind(wxEVT_PAINT, &GameScreen::OnPaint, this);
-    Bind(wxEVT_ERASE_BACKGROUND, &GameScreen::OnEraseBackground, this);
-    Bind(wxEVT_IDLE, &GameScreen::OnIdle, this);
+    Bind(wxEVT_SIZE, &GameScreen::OnSize, this);
+    Bind(EVT_FRAME_READY, &GameScreen::OnFrameReady, this);
+    Bind(wxEVT_KEY_DOWN, &GameScreen::OnKeyPressed, this);
     Bind(wxEVT_KEY_UP, &GameScreen::OnKeyReleased, this);
+    Bind(wxEVT_KILL_FOCUS, &GameScreen::OnKillFocus, this);
 
     m_console = console;
+    m_mailbox->screen = this;
+    m_worker = std::make_shared<nes::FilterWorker>([mailbox = m_mailbox] { mailbox->Notify(); });
+    auto submit = [worker = m_worker](nes::Display const& display) { worker->Submit(display); };
+    m_console->Send({Command::Type::FrameCallback, {}, false, submit});
+  }
+
+  ~GameScreen() {
+    std::lock_guard lock{m_mailbox->mutex};
+    m_mailbox->screen = nullptr;
+  }
+
+  // the smallest size the screen takes is one whole filtered frame
+  void SetFilter(nes::VideoFilter filter) {
+    m_worker->SetFilter(filter);
+    auto scale = static_cast<int>(nes::GetFilterScale(filter));
+    SetMinSize({256 * scale, 240 * scale});
   }
 
-  void SetPixelBuffer(unsigned char* pixel_buffer) { m_pixel_buffer = pixel_buffer; }
+  void OnPaint(wxPaintEvent&) {
+    TRACE_ZONE("GameScreen::OnPaint");
+    using Clock = std::chrono::steady_clock;
+
+    auto start = Clock::now();
+    {
+      wxAutoBufferedPaintDC dc{this};  // blits to the screen when it goes out of scope, if needed
+      dc.SetBackground(*wxBLACK_BRUSH);
+      dc.Clear();
+      if (m_bitmap.IsOk()) {
+        auto [w, h] = GetClientSize();
+        dc.DrawBitmap(m_bitmap, (w - m_bitmap.GetWidth()) / 2, (h - m_bitmap.GetHeight()) / 2);
+      }
+      if (m_show_stats) DrawStats(dc);
+    }
+    auto paint_ms = std::chrono::duration<double, std::milli>{Clock::now() - start}.count();
+    m_paint_ms += (paint_ms - m_paint_ms) / 16.0;
+  }
 
-  void OnPaint([[maybe_unused]] wxPaintEvent& event) {
-    if (m_pixel_buffer == nullptr) return;
+  void OnFrameReady(wxThreadEvent&) {
+    TRACE_ZONE("GameScreen::OnFrameReady");
+    using Clock = std::chrono::steady_clock;
 
-    auto [w, h] = GetSize();
-    wxBitmap bitmap{wxImage{256, 240, m_pixel_buffer, true}.Scale(w, h)};
-    wxBufferedPaintDC dc(this, bitmap);
+    auto start = Clock::now();
+    Upload();
+    auto upload_ms = std::chrono::duration<double, std::milli>{Clock::now() - start}.count();
+    m_upload_ms += (upload_ms - m_upload_ms) / 16.0;
+    Refresh(false);
   }
 
-  void OnEraseBackground(wxEraseEvent&) {}
-  void OnIdle(wxIdleEvent& event) {
+  void OnSize(wxSizeEvent& event) {
+    event.Skip();
+    Upload();
     Refresh(false);
-    wxMilliSleep(16);
-    event.RequestMore();
   }
 
 private:
+  using Command = nes::Console::Command;
+
   nes::Console* m_console = nullptr;
-  unsigned char* m_pixel_buffer = nullptr;
+  std::shared_ptr<FrameMailbox> m_mailbox = std::make_shared<FrameMailbox>();
+  std::shared_ptr<nes::FilterWorker> m_worker;
+  nes::NearestScaler m_scaler = {};
+  size_t m_frame_w = 0;
+  size_t m_frame_h = 0;
+  wxBitmap m_bitmap = {};
+  nes::byte_t m_buttons = 0;
+  bool m_show_stats = false;
+
+  // smoothed; the overlay shows the cost of the paints and uploads before it
+  double m_paint_ms = 0.0;
+  double m_upload_ms = 0.0;
+
+  // scales the latest filtered frame into m_bitmap, which is only reallocated when the scale or the
+  // filtered size changes
+  void Upload() {
+    {
+      std::lock_guard lock{m_mailbox->mutex};
+      m_mailbox->pending = false;
+    }
+
+    auto [w, h] = GetClientSize();
+    m_worker->Read([&](nes::byte_t const* frame, size_t frame_w, size_t frame_h) {
+      auto fit = std::min(w / static_cast<int>(frame_w), h / static_cast<int>(frame_h));
+      auto scale = static_cast<nes::uint>(std::max(1, fit));
+      if (scale != m_scaler.GetScale() || frame_w != m_frame_w || frame_h != m_frame_h) {
+        m_scaler.Configure(scale,
+                           {wxNativePixelFormat::SizePixel, wxNativePixelFormat::RED,
+                            wxNativePixelFormat::GREEN, wxNativePixelFormat::BLUE},
+                           frame_w, frame_h);
+        auto [bitmap_w, bitmap_h] = m_scaler.GetOutputSize();
+        m_bitmap.Create(static_cast<int>(bitmap_w), static_cast<int>(bitmap_h),
+                        wxNativePixelFormat::BitsPerPixel);
+        m_frame_w = frame_w;
+        m_frame_h = frame_h;
+      }
+
+      wxNativePixelData pixels{m_bitmap};
+      if (!pixels) return;
+      m_scaler.Scale(frame, wxNativePixelData::Iterator{pixels}.m_ptr, pixels.GetRowStride());
+    });
+  }
+
+  // bit of each key in the controller byte: A, B, Select, Start, Up, Down, Left, Right
+  static auto ButtonBit(int key_code) -> int {
+    switch (key_code) {
+    case 'X': return 0;
+    case 'Z': return 1;
+    case WXK_SHIFT: return 2;
+    case WXK_RETURN: return 3;
+    case WXK_UP: return 4;
+    case WXK_DOWN: return 5;
+    case WXK_LEFT: return 6;
+    case WXK_RIGHT: return 7;
+    default: return -1;
+    }
+  }
+
+  void SetButton(int key_code, bool pressed) {
+    auto bit = ButtonBit(key_code);
+    if (bit < 0) return;
+    pressed ? nes::SetBit(m_buttons, bit) : nes::ClearBit(m_buttons, bit);
+    m_console->SetInput(0, m_buttons);
+  }
+
+  void OnKeyPressed(wxKeyEvent& event) {
+    event.Skip();
+    SetButton(event.GetKeyCode(), true);
+    if (event.GetKeyCode() == WXK_TAB) m_console->Send({Command::Type::FastForward, {}, true});
+    if (event.GetKeyCode() == WXK_BACK) m_console->Send({Command::Type::Rewind, {}, true});
+  }
 
   void OnKeyReleased(wxKeyEvent& event) {
     event.Skip();
+    SetButton(event.GetKeyCode(), false);
     auto uc = event.GetUnicodeKey();
-    if (uc == 'p') m_console->Pause();
+    if (uc == 'p') m_console->Send({Command::Type::Pause});
+    if (event.GetKeyCode() == WXK_TAB) m_console->Send({Command::Type::FastForward, {}, false});
+    if (event.GetKeyCode() == WXK_BACK) m_console->Send({Command::Type::Rewind, {}, false});
+    if (event.GetKeyCode() == WXK_F3) ToggleStats();
+    if (event.GetKeyCode() == WXK_F4) TRACE_DUMP("renes-trace.json");
+  }
+
+  void ToggleStats() {
+    if (!m_console->Send({Command::Type::Stats, {}, !m_show_stats})) return;
+    m_show_stats = !m_show_stats;
+    Refresh(false);
+  }
+
+  void DrawStats(wxDC& dc) {
+    auto stats = m_console->GetStats();
+    auto Ms = [](double ns) { return ns / 1e6; };
+    auto text = wxString::Format(
+        "%.1f fps\n"
+        "cpu   %.2f ms\n"
+        "ppu   %.2f ms\n"
+        "apu   %.2f ms\n"
+        "end   %.2f ms\n"
+        "upload %.2f ms\n"
+        "paint %.2f ms\n"
+        "frame p50 %.1f  p99 %.1f ms\n"
+        "%llu instructions",
+        stats.fps, Ms(stats.cpu_ns), Ms(stats.ppu_ns), Ms(stats.apu_ns), Ms(stats.end_frame_ns),
+        m_upload_ms, m_paint_ms, stats.frame_ms_p50, stats.frame_ms_p99,
+        static_cast<unsigned long long>(stats.instructions));
+    if (stats.host_counters) {
+      text += wxString::Format("\nhost ipc %.2f\n%llu cache misses\n%llu branch misses",
+                               stats.host.Ipc(),
+                               static_cast<unsigned long long>(stats.host.cache_misses),
+                               static_cast<unsigned long long>(stats.host.branch_misses));
+    }
+
+    dc.SetFont(wxFontInfo(8).Family(wxFONTFAMILY_TELETYPE));
+    dc.SetTextForeground(*wxWHITE);
+    dc.SetTextBackground(*wxBLACK);
+    dc.SetBackgroundMode(wxBRUSHSTYLE_SOLID);
+    dc.DrawText(text, 4, 4);
+  }
+
+  // key-up events go elsewhere once focus is lost, so don't leave buttons held down
+  void OnKillFocus(wxFocusEvent& event) {
+    event.Skip();
+    m_buttons = 0;
+    m_console->SetInput(0, m_buttons);
   }
 };
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include <wx/wx.h>
 
 #include "gui/game_screen.hpp"
@@ -14,21 +16,15 @@ public:
 
     SetFont(wxFont{12, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL});
 
-    // yes, the const_cast makes me uncomfortable too... unfortunately, the wxImage constructor
-    // (used later) requires a pointer to non-const unsigned chars, even though it should only need
-    // read access to the data
-    using Display = std::remove_cv_t<std::remove_reference_t<decltype(m_console->GetDisplay())>>;
-    auto* pixel_buffer = const_cast<Display&>(m_console->GetDisplay()).GetRawPixelBuffer();
-
     m_game_screen = new GameScreen(this, console);
     m_game_screen->SetMinSize(m_game_screen->GetSize());
-    m_game_screen->SetPixelBuffer(pixel_buffer);
 
     auto sizer = new wxFlexGridSizer{2, 2, 0, 0};
     sizer->Add(m_game_screen, wxSizerFlags().Shaped().Border(wxALL, 4));
 
     m_menu_bar = new wxMenuBar();
     MakeFileMenu();
+    MakeVideoMenu();
 
     SetMenuBar(m_menu_bar);
 
@@ -40,8 +36,11 @@ public:
   }
 
 private:
+  using Command = nes::Console::Command;
+
   wxMenuBar* m_menu_bar = nullptr;
   wxMenu* m_file_menu = nullptr;
+  wxMenu* m_video_menu = nullptr;
   GameScreen* m_game_screen = nullptr;
   nes::Console* m_console = nullptr;
 
@@ -61,20 +60,43 @@ private:
   }
 
   void OnFileOpen(wxCommandEvent& event) {
-    m_console->Pause();
+    m_console->Send({Command::Type::Pause});
 
     wxFileDialog file_browser{this, "NES files (*.nes)|*.nes"};
     if (file_browser.ShowModal() == wxID_OK) {
       auto file = file_browser.GetPath().ToStdString();
-      LOG_DEBUG("[GUI] User selected '" + file + '\'');
-      m_console->Load(file);
+      LOG_DEBUG_IN(Gui, "User selected '" + file + '\'');
+      m_console->Send({Command::Type::Load, file});
     } else {
-      m_console->Unpause();
+      m_console->Send({Command::Type::Unpause});
     }
 
     event.Skip();
   }
-  
+
+  void MakeVideoMenu() {
+    m_video_menu = new wxMenu();
+
+    for (auto i = size_t{0}; i < nes::video_filter_names.size(); ++i) {
+      auto filter = static_cast<nes::VideoFilter>(i);
+      auto item = m_video_menu->AppendRadioItem(wxID_ANY, nes::video_filter_names[i]);
+      m_video_menu->Bind(
+          wxEVT_COMMAND_MENU_SELECTED, [this, filter](wxCommandEvent&) { SetFilter(filter); },
+          item->GetId());
+    }
+
+    m_menu_bar->Append(m_video_menu, "Video");
+  }
+
+  // grows the window when the filtered frame no longer fits; never shrinks it
+  void SetFilter(nes::VideoFilter filter) {
+    m_game_screen->SetFilter(filter);
+    auto min = GetSizer()->GetMinSize();
+    SetMinClientSize(min);
+    auto client = GetClientSize();
+    SetClientSize(std::max(client.x, min.x), std::max(client.y, min.y));
+    Layout();
+  }
 };
 
 }  // namespace gui
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "nes/apu.hpp"
+
+#include <algorithm>
+
+#include "nes/bus.hpp"
+
+namespace nes {
+
+namespace {
+
+constexpr std::array<byte_t, 32> length_table = {
+    10, 254, 20, 2,  40, 4,  80, 6,  160, 8,  60, 10, 14, 12, 26, 14,
+    12, 16,  24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+constexpr std::array<std::array<byte_t, 8>, 4> duty_table = {{
+    {0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 1, 1, 1, 0, 0, 0},
+    {1, 0, 0, 1, 1, 1, 1, 1},
+}};
+
+constexpr std::array<byte_t, 32> triangle_table = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3,  2,  1,  0,
+    0,  1,  2,  3,  4,  5,  6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+constexpr std::array<uint, 16> noise_periods = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+
+constexpr std::array<uint, 16> dmc_periods = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+// CPU cycles from the start of a frame counter sequence to each of its steps
+constexpr std::array<uint, 5> frame_steps = {7457, 14913, 22371, 29829, 37281};
+constexpr uint four_step_period = 29830;
+constexpr uint five_step_period = 37282;
+
+// Linear approximation of the mixer, in output units per step of each channel's level. The full
+// mix peaks at about 26000, leaving headroom below the 16-bit limit.
+constexpr int pulse_weight = 226;
+constexpr int triangle_weight = 255;
+constexpr int noise_weight = 148;
+constexpr int dmc_weight = 101;
+
+// samples buffered per frame, with room for a few frames of slack
+constexpr size_t max_frame_samples = 4096;
+
+}  // namespace
+
+// ----------------------------------------------
+// Channel helpers
+// ----------------------------------------------
+
+void Apu::Envelope::Clock() {
+  if (start) {
+    start = false;
+    decay = 15;
+    divider = volume;
+  } else if (divider == 0) {
+    divider = volume;
+    if (decay > 0) {
+      --decay;
+    } else if (loop) {
+      decay = 15;
+    }
+  } else {
+    --divider;
+  }
+}
+
+auto Apu::Pulse::SweepTarget() const -> int {
+  auto change = static_cast<int>(period >> sweep_shift);
+  if (!sweep_negate) return static_cast<int>(period) + change;
+  return static_cast<int>(period) - change - (ones_complement ? 1 : 0);
+}
+
+void Apu::Pulse::ClockSweep() {
+  if (sweep_divider == 0 && sweep_enabled && sweep_shift > 0 && !Muted()) {
+    period = static_cast<uint>(std::max(SweepTarget(), 0));
+  }
+  if (sweep_divider == 0 || sweep_reload) {
+    sweep_divider = sweep_period;
+    sweep_reload = false;
+  } else {
+    --sweep_divider;
+  }
+}
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+Apu::Apu()
+  : m_blip{clock_rate, sample_rate, max_frame_samples}, m_frame_samples(max_frame_samples) {
+  Reset();
+}
+
+void Apu::Reset() {
+  m_state = State{};
+  m_state.pulse[0].ones_complement = true;
+  m_blip.Clear();
+  ScheduleNextEvent();
+}
+
+void Apu::AttachBus(Bus* bus) { m_bus = AssumeNotNull(bus); }
+
+auto Apu::ReadStatus() -> byte_t {
+  Run(m_state.time);
+
+  auto& s = m_state;
+  byte_t status = 0;
+  if (s.pulse[0].length > 0) SetBit(status, 0);
+  if (s.pulse[1].length > 0) SetBit(status, 1);
+  if (s.triangle.length > 0) SetBit(status, 2);
+  if (s.noise.length > 0) SetBit(status, 3);
+  if (s.dmc.remaining > 0) SetBit(status, 4);
+  if (s.frame.irq) SetBit(status, 6);
+  if (s.dmc.irq) SetBit(status, 7);
+
+  s.frame.irq = false;
+  UpdateIrq();
+  return status;
+}
+
+void Apu::Write(addr_t addr, byte_t value) {
+  Run(m_state.time);
+
+  auto& s = m_state;
+  switch (addr) {
+  case locations::sq1_vol:
+  case locations::sq1_sweep:
+  case locations::sq1_lo:
+  case locations::sq1_hi: WritePulse(s.pulse[0], addr & 0x03, value); break;
+  case locations::sq2_vol:
+  case locations::sq2_sweep:
+  case locations::sq2_lo:
+  case locations::sq2_hi: WritePulse(s.pulse[1], addr & 0x03, value); break;
+
+  case locations::tri_linear:
+    s.triangle.control = TestBit(value, 7);
+    s.triangle.linear_reload = value & 0x7F;
+    break;
+  case locations::tri_lo: s.triangle.period = (s.triangle.period & 0x0700) | value; break;
+  case locations::tri_hi:
+    s.triangle.period = (s.triangle.period & 0x00FF) | ((value & 0x07) << 8);
+    if (s.triangle.enabled) s.triangle.length = length_table[value >> 3];
+    s.triangle.linear_reload_flag = true;
+    break;
+
+  case locations::noise_vol:
+    s.noise.envelope.loop = TestBit(value, 5);
+    s.noise.envelope.constant = TestBit(value, 4);
+    s.noise.envelope.volume = value & 0x0F;
+    break;
+  case locations::noise_lo:
+    s.noise.mode = TestBit(value, 7);
+    s.noise.period = noise_periods[value & 0x0F];
+    break;
+  case locations::noise_hi:
+    if (s.noise.enabled) s.noise.length = length_table[value >> 3];
+    s.noise.envelope.start = true;
+    break;
+
+  case locations::dmc_freq:
+    s.dmc.irq_enabled = TestBit(value, 7);
+    s.dmc.loop = TestBit(value, 6);
+    s.dmc.period = dmc_periods[value & 0x0F];
+    if (!s.dmc.irq_enabled) s.dmc.irq = false;
+    break;
+  case locations::dmc_raw: s.dmc.level = value & 0x7F; break;
+  case locations::dmc_start: s.dmc.sample_address = 0xC000 + value * 64; break;
+  case locations::dmc_len: s.dmc.sample_length = value * 16 + 1; break;
+
+  case locations::sound_channel:
+    s.pulse[0].enabled = TestBit(value, 0);
+    s.pulse[1].enabled = TestBit(value, 1);
+    s.triangle.enabled = TestBit(value, 2);
+    s.noise.enabled = TestBit(value, 3);
+    if (!s.pulse[0].enabled) s.pulse[0].length = 0;
+    if (!s.pulse[1].enabled) s.pulse[1].length = 0;
+    if (!s.triangle.enabled) s.triangle.length = 0;
+    if (!s.noise.enabled) s.noise.length = 0;
+
+    s.dmc.irq = false;
+    if (!TestBit(value, 4)) {
+      s.dmc.remaining = 0;
+    } else if (s.dmc.remaining == 0) {
+      s.dmc.address = s.dmc.sample_address;
+      s.dmc.remaining = s.dmc.sample_length;
+      FetchSample();
+    }
+    break;
+
+  case locations::frame_counter:
+    // the sequencer actually restarts 3-4 cycles after the write; close enough for audio
+    s.frame.five_step = TestBit(value, 7);
+    s.frame.irq_inhibit = TestBit(value, 6);
+    if (s.frame.irq_inhibit) s.frame.irq = false;
+    s.frame.step = 0;
+    s.frame.sequence_start = s.time;
+    if (s.frame.five_step) {
+      ClockQuarterFrame();
+      ClockHalfFrame();
+    }
+    break;
+
+  default: break;
+  }
+
+  UpdateIrq();
+  ScheduleNextEvent();
+}
+
+void Apu::SetOutputEnabled(bool enabled) { m_output_enabled = enabled; }
+
+void Apu::EndFrame(SampleRing& output) {
+  Run(m_state.time);
+  m_blip.EndFrame(static_cast<std::uint32_t>(m_state.time - m_state.frame_start));
+  m_state.frame_start = m_state.time;
+
+  m_frame_sample_count = m_blip.ReadSamples(m_frame_samples.data(), m_frame_samples.size());
+  output.Write(m_frame_samples.data(), m_frame_sample_count);
+}
+
+void Apu::SaveState(State& state) const { state = m_state; }
+
+void Apu::LoadState(State const& state) {
+  m_state = state;
+  ScheduleNextEvent();
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void Apu::RunEvents() {
+  Run(m_state.time);
+  ScheduleNextEvent();
+}
+
+void Apu::Run(std::uint64_t until) {
+  for (auto step = NextFrameStep(); step <= until; step = NextFrameStep()) {
+    RunChannels(step);
+    StepFrameCounter();
+  }
+  RunChannels(until);
+}
+
+void Apu::RunChannels(std::uint64_t until) {
+  if (until <= m_state.run_time) return;
+  RunPulse(m_state.pulse[0], until);
+  RunPulse(m_state.pulse[1], until);
+  RunTriangle(until);
+  RunNoise(until);
+  RunDmc(until);
+  m_state.run_time = until;
+}
+
+void Apu::RunPulse(Pulse& pulse, std::uint64_t until) {
+  auto volume = (pulse.length > 0 && !pulse.Muted()) ? pulse.envelope.Output() : 0;
+  auto step = 2 * (pulse.period + 1);
+  auto& duty = duty_table[pulse.duty];
+
+  Output(pulse.amplitude, duty[pulse.phase] * volume, pulse_weight, m_state.run_time);
+  if (pulse.next_clock >= until) return;
+
+  if (volume == 0) {
+    // silent: jump straight to the end, keeping the sequencer where it would have been
+    auto clocks = (until - pulse.next_clock + step - 1) / step;
+    pulse.phase = static_cast<byte_t>((pulse.phase + clocks) & 0x07);
+    pulse.next_clock += clocks * step;
+    return;
+  }
+
+  for (; pulse.next_clock < until; pulse.next_clock += step) {
+    pulse.phase = (pulse.phase + 1) & 0x07;
+    Output(pulse.amplitude, duty[pulse.phase] * volume, pulse_weight, pulse.next_clock);
+  }
+}
+
+void Apu::RunTriangle(std::uint64_t until) {
+  auto& tri = m_state.triangle;
+  auto step = tri.period + 1;
+
+  Output(tri.amplitude, triangle_table[tri.phase], triangle_weight, m_state.run_time);
+  if (tri.next_clock >= until) return;
+
+  // the sequencer only moves while both counters are running; ultrasonic periods are held still
+  // rather than aliasing into noise, like most emulators (and many TVs) do
+  if (tri.length == 0 || tri.linear == 0 || tri.period < 2) {
+    tri.next_clock += (until - tri.next_clock + step - 1) / step * step;
+    return;
+  }
+
+  for (; tri.next_clock < until; tri.next_clock += step) {
+    tri.phase = (tri.phase + 1) & 0x1F;
+    Output(tri.amplitude, triangle_table[tri.phase], triangle_weight, tri.next_clock);
+  }
+}
+
+void Apu::RunNoise(std::uint64_t until) {
+  auto& noise = m_state.noise;
+  auto volume = noise.length > 0 ? noise.envelope.Output() : 0;
+  auto tap = noise.mode ? 6 : 1;
+
+  Output(noise.amplitude, (noise.lfsr & 1) ? 0 : volume, noise_weight, m_state.run_time);
+  for (; noise.next_clock < until; noise.next_clock += noise.period) {
+    auto feedback = (noise.lfsr ^ (noise.lfsr >> tap)) & 1;
+    noise.lfsr = static_cast<std::uint16_t>((noise.lfsr >> 1) | (feedback << 14));
+    if (volume > 0) {
+      Output(noise.amplitude, (noise.lfsr & 1) ? 0 : volume, noise_weight, noise.next_clock);
+    }
+  }
+}
+
+void Apu::RunDmc(std::uint64_t until) {
+  auto& dmc = m_state.dmc;
+
+  Output(dmc.amplitude, dmc.level, dmc_weight, m_state.run_time);
+  for (; dmc.next_clock < until; dmc.next_clock += dmc.period) {
+    if (!dmc.silence) {
+      if (TestBit(dmc.shift, 0)) {
+        if (dmc.level <= 125) dmc.level += 2;
+      } else {
+        if (dmc.level >= 2) dmc.level -= 2;
+      }
+      dmc.shift >>= 1;
+      Output(dmc.amplitude, dmc.level, dmc_weight, dmc.next_clock);
+    }
+
+    if (--dmc.bits == 0) {
+      dmc.bits = 8;
+      dmc.silence = !dmc.buffer_full;
+      if (dmc.buffer_full) {
+        dmc.shift = dmc.buffer;
+        dmc.buffer_full = false;
+        FetchSample();
+      }
+    }
+  }
+}
+
+void Apu::FetchSample() {
+  auto& dmc = m_state.dmc;
+  if (dmc.buffer_full || dmc.remaining == 0) return;
+
+  // The CPU is held off the bus for the fetch. It is always charged the usual 4 cycles; the 3 it
+  // costs when it lands on a write cycle, and the shorter stalls during OAM DMA, aren't modelled.
+  m_bus->StallCpu(4);
+  dmc.buffer = m_bus->Read(dmc.address);
+  dmc.buffer_full = true;
+  dmc.address = (dmc.address == 0xFFFF) ? 0x8000 : dmc.address + 1;
+
+  if (--dmc.remaining == 0) {
+    if (dmc.loop) {
+      dmc.address = dmc.sample_address;
+      dmc.remaining = dmc.sample_length;
+    } else if (dmc.irq_enabled) {
+      dmc.irq = true;
+      UpdateIrq();
+    }
+  }
+}
+
+void Apu::ScheduleNextEvent() {
+  m_next_event = NextFrameStep();
+
+  // the channels have to catch up in time for each DMC fetch, since fetches can raise an IRQ
+  auto const& dmc = m_state.dmc;
+  if (dmc.remaining > 0) {
+    auto fetch = std::max(dmc.next_clock, m_state.run_time) + (dmc.bits - 1) * dmc.period;
+    m_next_event = std::min(m_next_event, fetch + 1);
+  }
+}
+
+// the APU's two IRQ sources each drive their own bit of the CPU's IRQ line
+void Apu::UpdateIrq() {
+  m_bus->SetIrq(Cpu::IrqSource::FrameCounter, m_state.frame.irq);
+  m_bus->SetIrq(Cpu::IrqSource::Dmc, m_state.dmc.irq);
+}
+
+void Apu::StepFrameCounter() {
+  auto& frame = m_state.frame;
+  auto last = frame.five_step ? 4 : 3;
+
+  if (frame.step != 3 || !frame.five_step) ClockQuarterFrame();
+  if (frame.step == 1 || frame.step == last) ClockHalfFrame();
+  if (frame.step == 3 && !frame.five_step && !frame.irq_inhibit) {
+    frame.irq = true;
+    UpdateIrq();
+  }
+
+  if (frame.step == last) {
+    frame.step = 0;
+    frame.sequence_start += frame.five_step ? five_step_period : four_step_period;
+  } else {
+    ++frame.step;
+  }
+}
+
+void Apu::ClockQuarterFrame() {
+  auto& s = m_state;
+  s.pulse[0].envelope.Clock();
+  s.pulse[1].envelope.Clock();
+  s.noise.envelope.Clock();
+
+  auto& tri = s.triangle;
+  if (tri.linear_reload_flag) {
+    tri.linear = tri.linear_reload;
+  } else if (tri.linear > 0) {
+    --tri.linear;
+  }
+  if (!tri.control) tri.linear_reload_flag = false;
+}
+
+void Apu::ClockHalfFrame() {
+  auto& s = m_state;
+  for (auto& pulse : s.pulse) {
+    if (pulse.length > 0 && !pulse.envelope.loop) --pulse.length;
+    pulse.ClockSweep();
+  }
+  if (s.triangle.length > 0 && !s.triangle.control) --s.triangle.length;
+  if (s.noise.length > 0 && !s.noise.envelope.loop) --s.noise.length;
+}
+
+auto Apu::NextFrameStep() const -> std::uint64_t {
+  return m_state.frame.sequence_start + frame_steps[m_state.frame.step];
+}
+
+void Apu::WritePulse(Pulse& pulse, uint reg, byte_t value) {
+  switch (reg) {
+  case 0:
+    pulse.duty = value >> 6;
+    pulse.envelope.loop = TestBit(value, 5);
+    pulse.envelope.constant = TestBit(value, 4);
+    pulse.envelope.volume = value & 0x0F;
+    break;
+  case 1:
+    pulse.sweep_enabled = TestBit(value, 7);
+    pulse.sweep_period = (value >> 4) & 0x07;
+    pulse.sweep_negate = TestBit(value, 3);
+    pulse.sweep_shift = value & 0x07;
+    pulse.sweep_reload = true;
+    break;
+  case 2: pulse.period = (pulse.period & 0x0700) | value; break;
+  case 3:
+    pulse.period = (pulse.period & 0x00FF) | ((value & 0x07) << 8);
+    if (pulse.enabled) pulse.length = length_table[value >> 3];
+    pulse.phase = 0;
+    pulse.envelope.start = true;
+    break;
+  }
+}
+
+void Apu::Output(int& amplitude, int level, int weight, std::uint64_t time) {
+  if (level == amplitude) return;
+  if (m_output_enabled) {
+    m_blip.AddDelta(static_cast<std::uint32_t>(time - m_state.frame_start),
+                    (level - amplitude) * weight);
+  }
+  amplitude = level;
+}
+
+}  // namespace nes
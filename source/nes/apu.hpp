@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <vector>
+
+#include "nes/blip_buffer.hpp"
+#include "nes/common.hpp"
+#include "nes/locations.hpp"
+#include "nes/sample_ring.hpp"
+#include "nes/utility.hpp"
+
+namespace nes {
+
+// The audio processing unit: two pulse channels, a triangle, noise, the delta modulation channel
+// and the frame counter.
+//
+// Channels are not stepped every CPU cycle. The APU only counts cycles; the channels catch up in
+// bulk whenever something could change them (a register access, a frame counter step, a DMC
+// fetch, the end of a frame) and record every change in their output as a delta at its exact
+// cycle. Band-limited synthesis turns those deltas into 48 kHz samples once per frame.
+class Apu {
+public:
+  static constexpr double clock_rate = 1'789'773.0;  // NTSC CPU clock
+  static constexpr double sample_rate = 48'000.0;
+
+  struct Envelope {
+    bool start = false;
+    bool loop = false;  // doubles as the length counter halt flag
+    bool constant = false;
+    byte_t volume = 0;
+    byte_t divider = 0;
+    byte_t decay = 0;
+
+    void Clock();
+    auto Output() const -> int { return constant ? volume : decay; }
+  };
+
+  struct Pulse {
+    Envelope envelope = {};
+    bool enabled = false;
+    bool ones_complement = false;  // pulse 1 negates its sweep with one's complement
+    byte_t duty = 0;
+    byte_t phase = 0;
+    byte_t length = 0;
+    uint period = 0;
+    std::uint64_t next_clock = 0;
+
+    bool sweep_enabled = false;
+    bool sweep_negate = false;
+    bool sweep_reload = false;
+    byte_t sweep_period = 0;
+    byte_t sweep_shift = 0;
+    byte_t sweep_divider = 0;
+
+    int amplitude = 0;
+
+    auto SweepTarget() const -> int;
+    auto Muted() const -> bool { return period < 8 || SweepTarget() > 0x7FF; }
+    void ClockSweep();
+  };
+
+  struct Triangle {
+    bool enabled = false;
+    bool control = false;  // doubles as the length counter halt flag
+    bool linear_reload_flag = false;
+    byte_t linear_reload = 0;
+    byte_t linear = 0;
+    byte_t length = 0;
+    byte_t phase = 0;
+    uint period = 0;
+    std::uint64_t next_clock = 0;
+    int amplitude = 0;
+  };
+
+  struct Noise {
+    Envelope envelope = {};
+    bool enabled = false;
+    bool mode = false;
+    byte_t length = 0;
+    std::uint16_t lfsr = 1;
+    uint period = 4;
+    std::uint64_t next_clock = 0;
+    int amplitude = 0;
+  };
+
+  struct Dmc {
+    bool irq_enabled = false;
+    bool loop = false;
+    bool irq = false;
+    bool silence = true;
+    bool buffer_full = false;
+    byte_t level = 0;
+    byte_t buffer = 0;
+    byte_t shift = 0;
+    byte_t bits = 8;
+    addr_t sample_address = 0xC000;
+    addr_t sample_length = 1;
+    addr_t address = 0xC000;
+    addr_t remaining = 0;
+    uint period = 428;
+    std::uint64_t next_clock = 0;
+    int amplitude = 0;
+  };
+
+  struct FrameCounter {
+    bool five_step = false;
+    bool irq_inhibit = false;
+    bool irq = false;
+    byte_t step = 0;
+    std::uint64_t sequence_start = 0;
+  };
+
+  struct State {
+    std::array<Pulse, 2> pulse;
+    Triangle triangle;
+    Noise noise;
+    Dmc dmc;
+    FrameCounter frame;
+    std::uint64_t time;         // CPU cycles since power on
+    std::uint64_t run_time;     // how far the channels have caught up
+    std::uint64_t frame_start;  // time of the last EndFrame
+  };
+
+  Apu();
+
+  void Reset();
+  void AttachBus(Bus* bus);
+
+  // advances the APU clock by one CPU cycle; cheap unless something is scheduled for this cycle
+  void Tick() {
+    if (++m_state.time >= m_next_event) RunEvents();
+  }
+
+  auto ReadStatus() -> byte_t;
+  void Write(addr_t addr, byte_t value);
+
+  // With output disabled the channels still run, but record nothing - for frames that get rolled
+  // back, like run-ahead.
+  void SetOutputEnabled(bool enabled);
+
+  // resamples everything up to now and writes the samples to `output`
+  void EndFrame(SampleRing& output);
+
+  // the samples the last EndFrame wrote, kept until the next one for other consumers (capture)
+  auto GetFrameSamples() const -> std::int16_t const* { return m_frame_samples.data(); }
+  auto GetFrameSampleCount() const -> size_t { return m_frame_sample_count; }
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
+
+private:
+  Bus* m_bus = nullptr;
+  State m_state = {};
+  std::uint64_t m_next_event = std::numeric_limits<std::uint64_t>::max();
+  bool m_output_enabled = true;
+  BlipBuffer m_blip;
+  std::vector<std::int16_t> m_frame_samples;
+  size_t m_frame_sample_count = 0;
+
+  void RunEvents();
+  void Run(std::uint64_t until);
+  void RunChannels(std::uint64_t until);
+  void RunPulse(Pulse& pulse, std::uint64_t until);
+  void RunTriangle(std::uint64_t until);
+  void RunNoise(std::uint64_t until);
+  void RunDmc(std::uint64_t until);
+  void FetchSample();
+  void ScheduleNextEvent();
+  void UpdateIrq();
+
+  void StepFrameCounter();
+  void ClockQuarterFrame();
+  void ClockHalfFrame();
+  auto NextFrameStep() const -> std::uint64_t;
+
+  void WritePulse(Pulse& pulse, uint reg, byte_t value);
+  void Output(int& amplitude, int level, int weight, std::uint64_t time);
+};
+
+}  // namespace nes
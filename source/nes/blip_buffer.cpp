@@ -0,0 +1,85 @@
+#include "nes/blip_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace nes {
+
+BlipBuffer::BlipBuffer(double clock_rate, double sample_rate, size_t max_samples)
+  : m_factor{static_cast<std::uint64_t>(std::llround(sample_rate / clock_rate * 0x1'0000'0000))},
+    m_buffer(max_samples + taps, 0) {
+  constexpr auto pi = 3.14159265358979323846;
+  constexpr auto cutoff = 0.9;  // of the output Nyquist frequency
+
+  // phase p holds the impulse for a step p/phases of a sample after the start of its first tap
+  for (auto p = 0; p < phases; ++p) {
+    auto taps_real = std::array<double, taps>{};
+    auto sum = 0.0;
+    for (auto i = 0; i < taps; ++i) {
+      auto x = (i - taps / 2 + 1) - static_cast<double>(p) / phases;
+      auto sinc = (x == 0.0) ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+      auto w = 2.0 * pi * (x + taps / 2) / taps;
+      auto blackman = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w);
+      taps_real[i] = sinc * blackman;
+      sum += taps_real[i];
+    }
+
+    // every phase must sum to exactly one, or steps would leave a residue that drifts the output
+    auto total = 0;
+    for (auto i = 0; i < taps; ++i) {
+      auto tap = std::lround(taps_real[i] / sum * (1 << kernel_bits));
+      m_kernel[p][i] = static_cast<std::int16_t>(tap);
+      total += m_kernel[p][i];
+    }
+    m_kernel[p][taps / 2 - 1] += static_cast<std::int16_t>((1 << kernel_bits) - total);
+  }
+}
+
+void BlipBuffer::AddDelta(std::uint32_t time, int delta) {
+  auto position = m_offset + time * m_factor;
+  auto index = static_cast<size_t>(position >> 32);
+  if (index + taps > m_buffer.size()) return;  // frame ran longer than the buffer holds
+
+  auto const& kernel = m_kernel[(position >> (32 - phase_bits)) & (phases - 1)];
+  auto* out = &m_buffer[index];
+  for (auto i = 0; i < taps; ++i) out[i] += delta * kernel[i];
+}
+
+void BlipBuffer::EndFrame(std::uint32_t clocks) {
+  m_offset += clocks * m_factor;
+  auto limit = std::uint64_t{m_buffer.size() - taps} << 32;
+  m_offset = std::min(m_offset, limit);
+}
+
+auto BlipBuffer::Available() const -> size_t { return static_cast<size_t>(m_offset >> 32); }
+
+auto BlipBuffer::ReadSamples(std::int16_t* out, size_t count) -> size_t {
+  count = std::min(count, Available());
+
+  constexpr auto min = int{std::numeric_limits<std::int16_t>::min()};
+  constexpr auto max = int{std::numeric_limits<std::int16_t>::max()};
+
+  auto sum = m_integrator;
+  for (auto i = size_t{0}; i < count; ++i) {
+    auto sample = sum >> kernel_bits;
+    sum += m_buffer[i];
+    out[i] = static_cast<std::int16_t>(std::clamp(sample, min, max));
+    sum -= sample * (1 << (kernel_bits - bass_shift));
+  }
+  m_integrator = sum;
+
+  // shift everything after the samples read (including the tails of pending steps) down
+  std::copy(m_buffer.begin() + count, m_buffer.end(), m_buffer.begin());
+  std::fill(m_buffer.end() - count, m_buffer.end(), 0);
+  m_offset -= std::uint64_t{count} << 32;
+  return count;
+}
+
+void BlipBuffer::Clear() {
+  m_offset = 0;
+  m_integrator = 0;
+  std::fill(m_buffer.begin(), m_buffer.end(), 0);
+}
+
+}  // namespace nes
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Band-limited synthesis of a signal that only ever changes in steps. Instead of generating the
+// signal at the source clock rate and filtering it down, each step is recorded as a delta at its
+// exact clock time, and added to the output as a band-limited step (a windowed sinc impulse,
+// integrated when samples are read out). The cost is per step rather than per clock.
+class BlipBuffer {
+public:
+  BlipBuffer(double clock_rate, double sample_rate, size_t max_samples);
+
+  // `time` is in clocks since the end of the last frame
+  void AddDelta(std::uint32_t time, int delta);
+
+  // makes the samples up to `clocks` after the last frame available for reading
+  void EndFrame(std::uint32_t clocks);
+
+  auto Available() const -> size_t;
+  auto ReadSamples(std::int16_t* out, size_t count) -> size_t;
+  void Clear();
+
+private:
+  static constexpr int taps = 16;
+  static constexpr int phase_bits = 5;
+  static constexpr int phases = 1 << phase_bits;
+  static constexpr int kernel_bits = 14;  // each kernel phase sums to 1 << kernel_bits
+  static constexpr int bass_shift = 9;    // DC-blocking high-pass, about 15 Hz at 48 kHz
+
+  std::uint64_t m_factor = 0;  // samples per clock, 32.32 fixed point
+  std::uint64_t m_offset = 0;  // position of the current frame's start in the buffer, 32.32
+  int m_integrator = 0;
+  std::vector<int> m_buffer;
+  std::array<std::array<std::int16_t, taps>, phases> m_kernel = {};
+};
+
+}  // namespace nes
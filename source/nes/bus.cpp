@@ -6,18 +6,29 @@ namespace nes {
 // Public member function definitions
 // ----------------------------------------------
 
+void Bus::AttachApu(Apu* apu) { m_apu = AssumeNotNull(apu); }
 void Bus::AttachCpu(Cpu* cpu) { m_cpu = AssumeNotNull(cpu); }
 void Bus::AttachPpu(Ppu* ppu) { m_ppu = AssumeNotNull(ppu); }
-void Bus::AttachCartridge(Cartridge* cartridge) { m_cartridge = AssumeNotNull(cartridge); }
+void Bus::AttachCartridge(Cartridge* cartridge) {
+  m_cartridge = AssumeNotNull(cartridge);
+  m_profiler.AttachCartridge(cartridge);
+}
 
 auto Bus::Read(addr_t addr) -> byte_t {
+  m_profiler.Read(addr);
   if (addr < 0x2000) {
     addr %= 0x0800;
     return m_ram[addr];
   } else if (addr < 0x4000) {
     return ReadFromPpuRegister(addr);
+  } else if (addr == locations::sound_channel) {
+    return m_apu->ReadStatus();
+  } else if (addr == locations::joystick1 || addr == locations::joystick2) {
+    return m_controllers.Read(addr - locations::joystick1);
   } else if (addr < 0x4020) {
-    // TODO: Access APU and Joystick registers
+    // the remaining APU and I/O registers are write only
+  } else if (addr >= 0x6000 && addr < 0x8000) {
+    return m_cartridge->ReadProgramRam(addr);
   } else {
     return m_cartridge->CpuRead(addr);
   }
@@ -26,27 +37,54 @@ auto Bus::Read(addr_t addr) -> byte_t {
 }
 
 void Bus::Write(addr_t addr, byte_t value) {
+  m_profiler.Write(addr);
   if (addr < 0x2000) {
     addr &= 0x07FF;
     m_ram[addr] = value;
   } else if (addr < 0x4000) {
     WriteToPpuRegister(addr, value);
+  } else if (addr <= locations::dmc_len || addr == locations::sound_channel ||
+             addr == locations::frame_counter) {
+    m_apu->Write(addr, value);
+  } else if (addr == locations::joystick1) {
+    m_controllers.Write(value);
   } else if (addr < 0x4020) {
-    // TODO: Access APU and Joystick registers
+    // TODO: OAM DMA
+  } else if (addr >= 0x6000 && addr < 0x8000) {
+    m_cartridge->WriteProgramRam(addr, value);
   } else {
     m_cartridge->CpuWrite(addr, value);
+    // a register write may have acknowledged the mapper's IRQ
+    m_cpu->SetIrq(Cpu::IrqSource::Mapper, m_cartridge->IrqPending());
   }
 }
 
 void Bus::RequestNmi() const { m_cpu->RequestNmi(); }
+void Bus::SetIrq(Cpu::IrqSource source, bool active) const { m_cpu->SetIrq(source, active); }
+void Bus::StallCpu(byte_t cycles) const { m_cpu->Stall(cycles); }
+
+auto Bus::GetRam() const -> std::array<byte_t, 0x0800> const& { return m_ram; }
+
+auto Bus::GetControllers() -> Controllers& { return m_controllers; }
+
+auto Bus::GetProfiler() -> Profiler& { return m_profiler; }
+auto Bus::GetProfiler() const -> Profiler const& { return m_profiler; }
+
+void Bus::SaveState(State& state) const {
+  state.ram = m_ram;
+  m_controllers.SaveState(state.controllers);
+}
+
+void Bus::LoadState(State const& state) {
+  m_ram = state.ram;
+  m_controllers.LoadState(state.controllers);
+}
 
 // ----------------------------------------------
 // Private member function definitions
 // ----------------------------------------------
 
 auto Bus::ReadFromPpuRegister(addr_t addr) -> byte_t {
-  static byte_t data_buffer = 0;
-
   auto& reg = m_ppu->m_reg;
   byte_t data = 0;
 
@@ -65,12 +103,12 @@ auto Bus::ReadFromPpuRegister(addr_t addr) -> byte_t {
   case locations::ppu_addr: break;
   case locations::ppu_data:
     // delayed read unless reading from palette memory
-    data = data_buffer;
-    data_buffer = m_ppu->Read(reg.v);
-    data = (reg.v >= locations::palettes) ? data_buffer : data;
+    data = reg.data;
+    reg.data = m_ppu->Read(reg.v);
+    data = (reg.v >= locations::palettes) ? reg.data : data;
     break;
   default:
-    LOG_ERROR("[BUS] Invalid read from PPU register (at " + Hexify(addr) + ')');
+    LOG_ERROR_IN(Bus, "Invalid read from PPU register (at " + Hexify(addr) + ')');
     throw std::runtime_error("[BUS] Invalid read from PPU register (at " + Hexify(addr) + ')');
   }
 
@@ -122,7 +160,7 @@ void Bus::WriteToPpuRegister(addr_t addr, byte_t value) {
     reg.v += m_ppu->IncModeY() ? 32 : 1;
     break;
   default:
-    LOG_ERROR("[BUS] Invalid write to PPU register (at " + Hexify(addr) + ')');
+    LOG_ERROR_IN(Bus, "Invalid write to PPU register (at " + Hexify(addr) + ')');
     throw std::runtime_error("Invalid write to PPU register");
   }
 }
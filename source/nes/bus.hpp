@@ -3,8 +3,11 @@
 #include <array>
 #include <stdexcept>
 
+#include "nes/apu.hpp"
+#include "nes/bus_profiler.hpp"
 #include "nes/cartridge.hpp"
 #include "nes/common.hpp"
+#include "nes/controllers.hpp"
 #include "nes/cpu.hpp"
 #include "nes/locations.hpp"
 #include "nes/ppu.hpp"
@@ -14,8 +17,21 @@ namespace nes {
 
 class Bus {
 public:
+  // counts every access when the build is configured with RENES_ENABLE_BUS_PROFILER=ON
+#if defined(RENES_ENABLE_BUS_PROFILER)
+  using Profiler = BusProfiler;
+#else
+  using Profiler = NullBusProfiler;
+#endif
+
+  struct State {
+    std::array<byte_t, 0x0800> ram;
+    Controllers::State controllers;
+  };
+
   Bus() = default;
 
+  void AttachApu(Apu* apu);
   void AttachCpu(Cpu* cpu);
   void AttachPpu(Ppu* ppu);
   void AttachCartridge(Cartridge* cartridge);
@@ -24,12 +40,25 @@ public:
   void Write(addr_t addr, byte_t value);
 
   void RequestNmi() const;
+  void SetIrq(Cpu::IrqSource source, bool active) const;
+  void StallCpu(byte_t cycles) const;
+
+  auto GetRam() const -> std::array<byte_t, 0x0800> const&;
+  auto GetControllers() -> Controllers&;
+  auto GetProfiler() -> Profiler&;
+  auto GetProfiler() const -> Profiler const&;
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
 
 private:
+  Apu* m_apu = nullptr;
   Cpu* m_cpu = nullptr;
   Ppu* m_ppu = nullptr;
   Cartridge* m_cartridge = nullptr;
   std::array<byte_t, 0x0800> m_ram;
+  Controllers m_controllers;
+  Profiler m_profiler;
 
   auto ReadFromPpuRegister(addr_t addr) -> byte_t;
   void WriteToPpuRegister(addr_t addr, byte_t value);
@@ -0,0 +1,108 @@
+#include "nes/bus_profiler.hpp"
+
+#include <fstream>
+
+#include "nes/utility.hpp"
+
+namespace nes {
+
+namespace {
+
+// opens `file`, has `write` fill it in, and reports whether everything reached the disk
+template <class F>
+auto WriteFile(std::string const& file, F write) -> bool {
+  auto out = std::ofstream{file};
+  if (out) write(out);
+  if (!out) {
+    LOG_WARN("Could not write bus profile '" + file + '\'');
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+BusProfiler::BusProfiler() : m_addresses(0x10000) {}
+
+void BusProfiler::AttachCartridge(Cartridge const* cartridge) {
+  m_cartridge = AssumeNotNull(cartridge);
+}
+
+void BusProfiler::EndFrame() {
+  if (m_paused) return;
+  m_frames.push_back(m_frame);
+  m_frame = {};
+}
+
+void BusProfiler::SetPaused(bool paused) { m_paused = paused; }
+
+void BusProfiler::Reset() {
+  m_addresses.assign(m_addresses.size(), {});
+  m_banks.clear();
+  m_frames.clear();
+  m_frame = {};
+}
+
+auto BusProfiler::GetAddresses() const -> std::vector<BusCounts> const& { return m_addresses; }
+
+auto BusProfiler::GetRegions() const -> std::array<BusCounts, bus_region_count> {
+  auto regions = std::array<BusCounts, bus_region_count>{};
+  for (auto addr = size_t{0}; addr < m_addresses.size(); ++addr) {
+    auto& region = regions[static_cast<size_t>(GetBusRegion(static_cast<addr_t>(addr)))];
+    region.reads += m_addresses[addr].reads;
+    region.writes += m_addresses[addr].writes;
+  }
+  return regions;
+}
+
+auto BusProfiler::GetBanks() const -> std::vector<std::uint64_t> const& { return m_banks; }
+
+auto BusProfiler::GetFrames() const -> std::vector<FrameCounts> const& { return m_frames; }
+
+auto BusProfiler::WriteCsv(std::string const& prefix) const -> bool {
+  auto ok = WriteFile(prefix + ".addresses.csv", [&](std::ostream& out) {
+    out << "address,region,reads,writes\n";
+    for (auto addr = size_t{0}; addr < m_addresses.size(); ++addr) {
+      auto [reads, writes] = m_addresses[addr];
+      if (reads == 0 && writes == 0) continue;
+      out << Hexify(static_cast<addr_t>(addr)) << ','
+          << bus_region_names[static_cast<size_t>(GetBusRegion(static_cast<addr_t>(addr)))] << ','
+          << reads << ',' << writes << '\n';
+    }
+  });
+
+  ok &= WriteFile(prefix + ".regions.csv", [&](std::ostream& out) {
+    out << "region,reads,writes\n";
+    auto regions = GetRegions();
+    for (auto i = size_t{0}; i < bus_region_count; ++i) {
+      out << bus_region_names[i] << ',' << regions[i].reads << ',' << regions[i].writes << '\n';
+    }
+  });
+
+  ok &= WriteFile(prefix + ".banks.csv", [&](std::ostream& out) {
+    out << "bank,prg_rom_offset,reads\n";
+    for (auto bank = size_t{0}; bank < m_banks.size(); ++bank) {
+      out << bank << ',' << bank * bank_size << ',' << m_banks[bank] << '\n';
+    }
+  });
+
+  ok &= WriteFile(prefix + ".frames.csv", [&](std::ostream& out) {
+    out << "frame";
+    for (auto name : bus_region_names) out << ',' << name;
+    out << '\n';
+    for (auto frame = size_t{0}; frame < m_frames.size(); ++frame) {
+      out << frame;
+      for (auto count : m_frames[frame]) out << ',' << count;
+      out << '\n';
+    }
+  });
+
+  if (ok) LOG_INFO("Wrote bus profile of " + std::to_string(m_frames.size()) + " frames");
+  return ok;
+}
+
+}  // namespace nes
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "nes/cartridge.hpp"
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Parts of the CPU address space the profiler tallies separately. Every PPU register gets its own
+// region, mirrors included.
+enum class BusRegion : std::uint8_t {
+  Ram,
+  PpuCtrl,
+  PpuMask,
+  PpuStatus,
+  OamAddr,
+  OamData,
+  PpuScroll,
+  PpuAddr,
+  PpuData,
+  ApuIo,
+  Expansion,
+  PrgRam,
+  PrgRom,
+  Count,
+};
+
+constexpr auto bus_region_count = static_cast<size_t>(BusRegion::Count);
+
+constexpr std::array<char const*, bus_region_count> bus_region_names = {
+    "ram",      "ppu_ctrl", "ppu_mask", "ppu_status", "oam_addr", "oam_data", "ppu_scroll",
+    "ppu_addr", "ppu_data", "apu_io",   "expansion",  "prg_ram",  "prg_rom",
+};
+
+constexpr auto GetBusRegion(addr_t addr) -> BusRegion {
+  if (addr < 0x2000) return BusRegion::Ram;
+  if (addr < 0x4000) return static_cast<BusRegion>(static_cast<int>(BusRegion::PpuCtrl) + addr % 8);
+  if (addr < 0x4020) return BusRegion::ApuIo;
+  if (addr < 0x6000) return BusRegion::Expansion;
+  if (addr < 0x8000) return BusRegion::PrgRam;
+  return BusRegion::PrgRom;
+}
+
+struct BusCounts {
+  std::uint64_t reads = 0;
+  std::uint64_t writes = 0;
+};
+
+// The profiler Bus uses unless the build is configured with RENES_ENABLE_BUS_PROFILER=ON. Every
+// call is an empty inline function, so profiling costs nothing when it isn't compiled in.
+class NullBusProfiler {
+public:
+  void AttachCartridge(Cartridge const*) {}
+  void Read(addr_t) {}
+  void Write(addr_t) {}
+  void EndFrame() {}
+  void SetPaused(bool) {}
+  void Reset() {}
+
+  auto WriteCsv(std::string const&) const -> bool {
+    LOG_WARN("This build has no bus profiler; configure with RENES_ENABLE_BUS_PROFILER=ON");
+    return false;
+  }
+};
+
+// Tallies every CPU bus access three ways: per address (a heatmap of the whole 64 KiB), per 8 KiB
+// PRG-ROM bank read through the mapper, and per region for every frame.
+class BusProfiler {
+public:
+  static constexpr size_t bank_size = 0x2000;
+
+  // accesses (reads and writes together) to each BusRegion during one frame
+  using FrameCounts = std::array<std::uint32_t, bus_region_count>;
+
+  BusProfiler();
+
+  void AttachCartridge(Cartridge const* cartridge);
+
+  void Read(addr_t addr) {
+    if (m_paused) return;
+    ++m_addresses[addr].reads;
+    ++m_frame[static_cast<size_t>(GetBusRegion(addr))];
+    if (addr >= 0x8000) CountBank(m_cartridge->ProgramOffset(addr) / bank_size);
+  }
+
+  void Write(addr_t addr) {
+    if (m_paused) return;
+    ++m_addresses[addr].writes;
+    ++m_frame[static_cast<size_t>(GetBusRegion(addr))];
+  }
+
+  void EndFrame();
+
+  // accesses made while paused (e.g. by frames that are run ahead and rolled back) aren't counted
+  void SetPaused(bool paused);
+  void Reset();
+
+  auto GetAddresses() const -> std::vector<BusCounts> const&;
+  auto GetRegions() const -> std::array<BusCounts, bus_region_count>;
+  auto GetBanks() const -> std::vector<std::uint64_t> const&;  // reads per PRG-ROM bank
+  auto GetFrames() const -> std::vector<FrameCounts> const&;
+
+  // Writes `prefix`.addresses.csv (every address accessed at least once), `prefix`.regions.csv,
+  // `prefix`.banks.csv and `prefix`.frames.csv.
+  auto WriteCsv(std::string const& prefix) const -> bool;
+
+private:
+  Cartridge const* m_cartridge = nullptr;
+  bool m_paused = false;
+
+  std::vector<BusCounts> m_addresses;
+  std::vector<std::uint64_t> m_banks;
+  std::vector<FrameCounts> m_frames;
+  FrameCounts m_frame = {};
+
+  void CountBank(size_t bank) {
+    if (bank >= m_banks.size()) m_banks.resize(bank + 1);
+    ++m_banks[bank];
+  }
+};
+
+}  // namespace nes
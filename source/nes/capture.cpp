@@ -0,0 +1,325 @@
+#include "nes/capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "nes/apu.hpp"
+#include "nes/frame_pacer.hpp"
+#include "nes/logger.hpp"
+#include "nes/simd.hpp"
+#include "nes/trace.hpp"
+
+namespace nes {
+
+namespace {
+
+auto OpenOutput(string const& file) -> std::FILE* {
+  auto* out = file == "-" ? stdout : std::fopen(file.c_str(), "wb");
+  if (out == nullptr) {
+    LOG_WARN("Could not open capture file '" + file + '\'');
+    return nullptr;
+  }
+  // frames are written whole, so a large buffer saves a system call per few kilobytes
+  std::setvbuf(out, nullptr, _IOFBF, 1 << 20);
+  return out;
+}
+
+auto CloseOutput(std::FILE* out) -> bool {
+  if (out == stdout) return std::fflush(out) == 0;
+  return std::fclose(out) == 0;
+}
+
+// 16-bit mono PCM at the APU's output rate. Streams that can't seek back to fix the sizes keep the
+// largest ones, which readers take to mean "until the end of the stream".
+auto WriteWavHeader(std::FILE* out, std::uint64_t samples) -> bool {
+  auto data_bytes = static_cast<std::uint32_t>(std::min<std::uint64_t>(2 * samples, 0xFFFF'FFDB));
+  auto rate = static_cast<std::uint32_t>(Apu::sample_rate);
+
+  auto header = std::array<byte_t, 44>{};
+  auto* p = header.data();
+  auto Put = [&](std::uint32_t value, int bytes) {
+    for (auto i = 0; i < bytes; ++i) *p++ = static_cast<byte_t>((value >> (8 * i)) & 0xFF);
+  };
+  auto PutTag = [&](char const* tag) {
+    std::memcpy(p, tag, 4);
+    p += 4;
+  };
+
+  PutTag("RIFF");
+  Put(36 + data_bytes, 4);
+  PutTag("WAVE");
+  PutTag("fmt ");
+  Put(16, 4);        // format chunk size
+  Put(1, 2);         // PCM
+  Put(1, 2);         // channels
+  Put(rate, 4);      // sample rate
+  Put(rate * 2, 4);  // byte rate
+  Put(2, 2);         // block align
+  Put(16, 2);        // bits per sample
+  PutTag("data");
+  Put(data_bytes, 4);
+  return std::fwrite(header.data(), 1, header.size(), out) == header.size();
+}
+
+// BT.601 limited range, in 8.8 fixed point
+constexpr auto ToY(int r, int g, int b) { return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16; }
+constexpr auto ToU(int r, int g, int b) { return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128; }
+constexpr auto ToV(int r, int g, int b) { return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128; }
+
+void RgbToYuv420Scalar(byte_t const* rgb, size_t width, size_t height, byte_t* y, byte_t* u,
+                       byte_t* v) {
+  for (auto row = size_t{0}; row < height; row += 2) {
+    auto const* top = rgb + row * width * 3;
+    auto const* bottom = top + width * 3;
+    for (auto x = size_t{0}; x < width; x += 2) {
+      auto r = 0, g = 0, b = 0;
+      for (auto const* pixel : {top + 3 * x, top + 3 * x + 3, bottom + 3 * x, bottom + 3 * x + 3}) {
+        r += pixel[0];
+        g += pixel[1];
+        b += pixel[2];
+      }
+      for (auto [pixel, out] : {std::pair{top + 3 * x, y + row * width + x},
+                                {top + 3 * x + 3, y + row * width + x + 1},
+                                {bottom + 3 * x, y + (row + 1) * width + x},
+                                {bottom + 3 * x + 3, y + (row + 1) * width + x + 1}}) {
+        *out = static_cast<byte_t>(ToY(pixel[0], pixel[1], pixel[2]));
+      }
+      auto chroma = (row / 2) * (width / 2) + x / 2;
+      r = (r + 2) >> 2, g = (g + 2) >> 2, b = (b + 2) >> 2;
+      u[chroma] = static_cast<byte_t>(ToU(r, g, b));
+      v[chroma] = static_cast<byte_t>(ToV(r, g, b));
+    }
+  }
+}
+
+#if defined(RENES_SIMD_X86)
+// byte shuffles gathering one channel of eight RGB pixels into 16-bit lanes: pixels 0-4 from the
+// 16 bytes at the start, 5-7 from the 16 bytes starting 8 in
+auto const channel_masks = [] {
+  std::array<std::array<byte_t, 16>, 6> masks;
+  for (auto channel = 0; channel < 3; ++channel) {
+    auto& low = masks[2 * channel];
+    auto& high = masks[2 * channel + 1];
+    low.fill(0x80);
+    high.fill(0x80);
+    for (auto pixel = 0; pixel < 8; ++pixel) {
+      auto byte = 3 * pixel + channel;
+      if (pixel < 5) low[2 * pixel] = static_cast<byte_t>(byte);
+      else high[2 * pixel] = static_cast<byte_t>(byte - 8);
+    }
+  }
+  return masks;
+}();
+
+RENES_TARGET_SSSE3 inline auto Gather(byte_t const* pixels, int channel) -> __m128i {
+  auto Load = [](void const* p) { return _mm_loadu_si128(static_cast<__m128i const*>(p)); };
+  auto low = _mm_shuffle_epi8(Load(pixels), Load(channel_masks[2 * channel].data()));
+  auto high = _mm_shuffle_epi8(Load(pixels + 8), Load(channel_masks[2 * channel + 1].data()));
+  return _mm_or_si128(low, high);
+}
+
+// (wr * r + wg * g + wb * b + 128) >> 8, shifted as unsigned for luma, whose sums reach 56228
+template <short wr, short wg, short wb>
+RENES_TARGET_SSSE3 inline auto Weigh(__m128i r, __m128i g, __m128i b) -> __m128i {
+  auto sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(wr)),
+                           _mm_mullo_epi16(g, _mm_set1_epi16(wg)));
+  sum = _mm_add_epi16(_mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(wb))),
+                      _mm_set1_epi16(128));
+  return wr < 0 || wg < 0 || wb < 0 ? _mm_srai_epi16(sum, 8) : _mm_srli_epi16(sum, 8);
+}
+
+// adds horizontal pairs of a two-row sum and averages each 2x2 block, into the low four lanes
+RENES_TARGET_SSSE3 inline auto Average(__m128i rows) -> __m128i {
+  auto sums = _mm_madd_epi16(rows, _mm_set1_epi16(1));
+  return _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(sums, sums), _mm_set1_epi16(2)), 2);
+}
+
+// Eight pixels of two rows at a time: the channels are gathered with byte shuffles, and the 2x2
+// chroma averages come from a pairwise multiply-add.
+RENES_TARGET_SSSE3 void RgbToYuv420Ssse3(byte_t const* rgb, size_t width, size_t height, byte_t* y,
+                                         byte_t* u, byte_t* v) {
+  auto const offset_y = _mm_set1_epi16(16);
+  auto const offset_uv = _mm_set1_epi16(128);
+
+  for (auto row = size_t{0}; row < height; row += 2) {
+    auto const* top = rgb + row * width * 3;
+    auto const* bottom = top + width * 3;
+    auto* y_top = y + row * width;
+    auto* y_bottom = y_top + width;
+    auto* u_row = u + (row / 2) * (width / 2);
+    auto* v_row = v + (row / 2) * (width / 2);
+
+    for (auto x = size_t{0}; x < width; x += 8) {
+      auto r0 = Gather(top + 3 * x, 0), g0 = Gather(top + 3 * x, 1), b0 = Gather(top + 3 * x, 2);
+      auto r1 = Gather(bottom + 3 * x, 0), g1 = Gather(bottom + 3 * x, 1);
+      auto b1 = Gather(bottom + 3 * x, 2);
+
+      auto luma0 = _mm_add_epi16(Weigh<66, 129, 25>(r0, g0, b0), offset_y);
+      auto luma1 = _mm_add_epi16(Weigh<66, 129, 25>(r1, g1, b1), offset_y);
+      auto luma = _mm_packus_epi16(luma0, luma1);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(y_top + x), luma);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(y_bottom + x), _mm_unpackhi_epi64(luma, luma));
+
+      auto r = Average(_mm_add_epi16(r0, r1));
+      auto g = Average(_mm_add_epi16(g0, g1));
+      auto b = Average(_mm_add_epi16(b0, b1));
+      auto cb = _mm_add_epi16(Weigh<-38, -74, 112>(r, g, b), offset_uv);
+      auto cr = _mm_add_epi16(Weigh<112, -94, -18>(r, g, b), offset_uv);
+      auto chroma = _mm_packus_epi16(cb, cr);  // 4 U in bytes 0-3, 4 V in bytes 8-11
+      auto cb_bytes = _mm_cvtsi128_si32(chroma);
+      auto cr_bytes = _mm_cvtsi128_si32(_mm_unpackhi_epi64(chroma, chroma));
+      std::memcpy(u_row + x / 2, &cb_bytes, 4);
+      std::memcpy(v_row + x / 2, &cr_bytes, 4);
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+void RgbToYuv420(byte_t const* rgb, size_t width, size_t height, byte_t* y, byte_t* u, byte_t* v) {
+#if defined(RENES_SIMD_X86)
+  if (width % 8 == 0 && HostHasSsse3()) return RgbToYuv420Ssse3(rgb, width, height, y, u, v);
+#endif
+  RgbToYuv420Scalar(rgb, width, height, y, u, v);
+}
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+Capture::~Capture() { Close(); }
+
+auto Capture::Open(string const& video_file, string const& audio_file) -> bool {
+  Close();
+  if (video_file == "-" && audio_file == "-") {
+    LOG_WARN("Can't capture both video and audio to standard output");
+    return false;
+  }
+
+  if (!video_file.empty() && (m_video = OpenOutput(video_file)) == nullptr) return false;
+  if (!audio_file.empty() && (m_audio = OpenOutput(audio_file)) == nullptr) {
+    if (m_video) CloseOutput(m_video);
+    m_video = nullptr;
+    return false;
+  }
+
+  // the frame rate is the NTSC refresh rate to the same precision the pacer uses
+  auto ok = true;
+  if (m_video) {
+    auto [w, h] = Display::Size();
+    auto rate = static_cast<int>(FramePacer::ntsc_frame_rate * 1000 + 0.5);
+    ok &= std::fprintf(m_video, "YUV4MPEG2 W%zu H%zu F%d:1000 Ip A1:1 C420jpeg %s\n", w, h, rate,
+                       "XCOLORRANGE=LIMITED") > 0;
+  }
+  if (m_audio) ok &= WriteWavHeader(m_audio, UINT32_MAX);
+  if (!ok) LOG_WARN("Could not write capture headers");
+
+  m_frames = 0;
+  m_samples = 0;
+  m_stalls = 0;
+  m_failed = !ok;
+  m_slots.resize(pool_size);
+  m_head = 0;
+  m_count = 0;
+  m_stopping = false;
+  m_yuv.resize(Display::Width() * Display::Height() * 3 / 2);
+  m_thread = std::thread{&Capture::WriteLoop, this};
+  return true;
+}
+
+auto Capture::Close() -> bool {
+  if (!IsOpen()) return true;
+
+  {
+    std::lock_guard lock{m_mutex};
+    m_stopping = true;
+  }
+  m_filled.notify_one();
+  m_thread.join();
+
+  auto ok = !m_failed;
+  if (m_video) ok &= CloseOutput(m_video);
+  if (m_audio) {
+    // pipes can't seek, so they keep the open-ended header
+    if (std::fseek(m_audio, 0, SEEK_SET) == 0) ok &= WriteWavHeader(m_audio, m_samples);
+    ok &= CloseOutput(m_audio);
+  }
+  m_video = nullptr;
+  m_audio = nullptr;
+
+  LOG_INFO("Captured " + std::to_string(m_frames) + " frames and " + std::to_string(m_samples) +
+           " audio samples; " + std::to_string(m_stalls) + " frames waited for the writer");
+  if (!ok) LOG_WARN("Capture failed to write everything");
+  return ok;
+}
+
+void Capture::AddFrame(Display const* display, std::int16_t const* samples, size_t count) {
+  if (!IsOpen()) return;
+  TRACE_ZONE("Capture::AddFrame");
+
+  auto lock = std::unique_lock{m_mutex};
+  if (m_count == pool_size) {
+    ++m_stalls;
+    m_freed.wait(lock, [this] { return m_count < pool_size; });
+  }
+  auto& slot = m_slots[(m_head + m_count) % pool_size];
+  lock.unlock();
+
+  // the writer doesn't look at this slot until it's counted
+  slot.has_video = m_video != nullptr && display != nullptr;
+  if (slot.has_video) {
+    std::copy_n(display->GetRawPixelBuffer(), slot.rgb.size(), slot.rgb.data());
+  }
+  slot.audio.assign(samples, samples + (m_audio ? count : 0));
+
+  lock.lock();
+  ++m_count;
+  lock.unlock();
+  m_filled.notify_one();
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void Capture::WriteLoop() {
+  TRACE_THREAD("capture");
+  auto lock = std::unique_lock{m_mutex};
+  while (true) {
+    m_filled.wait(lock, [this] { return m_count > 0 || m_stopping; });
+    if (m_count == 0) return;
+
+    auto const& slot = m_slots[m_head];
+    lock.unlock();
+    WriteSlot(slot);
+    lock.lock();
+
+    m_head = (m_head + 1) % pool_size;
+    --m_count;
+    m_freed.notify_one();
+  }
+}
+
+void Capture::WriteSlot(Slot const& slot) {
+  TRACE_ZONE("Capture::WriteSlot");
+  if (m_failed) return;
+
+  if (slot.has_video) {
+    auto [w, h] = Display::Size();
+    auto* y = m_yuv.data();
+    RgbToYuv420(slot.rgb.data(), w, h, y, y + w * h, y + w * h * 5 / 4);
+    m_failed |= std::fputs("FRAME\n", m_video) < 0;
+    m_failed |= std::fwrite(m_yuv.data(), 1, m_yuv.size(), m_video) != m_yuv.size();
+    ++m_frames;
+  }
+  if (!slot.audio.empty()) {
+    // WAV is little endian, like every host this builds on
+    m_failed |= std::fwrite(slot.audio.data(), 2, slot.audio.size(), m_audio) != slot.audio.size();
+    m_samples += slot.audio.size();
+  }
+
+  if (m_failed) LOG_WARN("Could not write capture; dropping the rest of it");
+}
+
+}  // namespace nes
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/display.hpp"
+
+namespace nes {
+
+// Streams frames to a YUV4MPEG2 file (8-bit 4:2:0, for ffmpeg and friends) and audio to a 16-bit
+// mono WAV, either of which may be a pipe. The emulation thread only copies each frame into a slot
+// of a small pool; a writer thread converts it to YUV and writes it out. If the writer falls a
+// whole pool behind, the next frame waits for a slot rather than being lost from the recording.
+class Capture {
+public:
+  static constexpr size_t pool_size = 8;
+
+  Capture() = default;
+  Capture(Capture const&) = delete;
+  Capture& operator=(Capture const&) = delete;
+  ~Capture();
+
+  // Either file may be empty to leave that stream out; "-" is standard output. Returns false if a
+  // file can't be opened, in which case nothing is captured.
+  auto Open(string const& video_file, string const& audio_file) -> bool;
+
+  // writes out every frame still in the pool and finishes the files; false if any write failed
+  auto Close() -> bool;
+
+  auto IsOpen() const -> bool { return m_thread.joinable(); }
+  auto HasVideo() const -> bool { return m_video != nullptr; }
+
+  // `display` is ignored without a video file and may be null for frames that weren't drawn
+  void AddFrame(Display const* display, std::int16_t const* samples, size_t count);
+
+private:
+  struct Slot {
+    std::array<byte_t, Display::Width() * Display::Height() * 3> rgb;
+    bool has_video = false;
+    std::vector<std::int16_t> audio;
+  };
+
+  std::FILE* m_video = nullptr;
+  std::FILE* m_audio = nullptr;
+  std::uint64_t m_frames = 0;
+  std::uint64_t m_samples = 0;
+  std::uint64_t m_stalls = 0;  // frames that had to wait for the writer
+  bool m_failed = false;
+
+  // slots [m_head, m_head + m_count) are waiting to be written, oldest first
+  std::vector<Slot> m_slots;
+  size_t m_head = 0;
+  size_t m_count = 0;
+  bool m_stopping = false;
+
+  std::mutex m_mutex;
+  std::condition_variable m_filled;
+  std::condition_variable m_freed;
+  std::thread m_thread;
+
+  // only touched by the writer thread
+  std::vector<byte_t> m_yuv;
+
+  void WriteLoop();
+  void WriteSlot(Slot const& slot);
+};
+
+// Converts packed RGB to planar 8-bit 4:2:0 YUV (BT.601, limited range), each chroma sample the
+// average of a 2x2 block. Width and height must be even.
+void RgbToYuv420(byte_t const* rgb, size_t width, size_t height, byte_t* y, byte_t* u, byte_t* v);
+
+}  // namespace nes
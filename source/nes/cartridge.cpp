@@ -8,33 +8,34 @@ namespace nes {
 
 auto Cartridge::Load(string const& file) -> bool {
   m_mapper.reset();
+  m_prg_ram.Release();
 
   LOG_INFO("Loading NES file '" + file + '\'');
 
-  std::vector<byte_t> contents;
   auto in = std::ifstream{file, std::ios::binary};
-  if (in) {
-    contents = std::vector<byte_t>(std::istreambuf_iterator<char>(in), {});
-    if (contents.size() <= 16) {
-      LOG_INFO("... File '" + file + "' is not a valid NES file");
-      return false;
-    }
-  } else {
+  if (!in) {
     LOG_WARN("... Could not read contents of '" + file + '\'');
     return false;
   }
 
-  if (!Validate(contents)) {
-    LOG_INFO("... File '" + file + "' is not a valid NES file");
-    return false;
-  }
+  auto contents = std::vector<byte_t>(std::istreambuf_iterator<char>(in), {});
+  return LoadContents(file, contents, m_persistent_saves);
+}
 
-  return ParseContents(contents) && Valid();
+auto Cartridge::Load(string const& name, std::vector<byte_t> const& contents) -> bool {
+  return LoadContents(name, contents, false);
 }
 
-auto Cartridge::Valid() -> bool { return (!!m_mapper) && (m_mapper->Valid()); }
+void Cartridge::SetPersistentSaves(bool enabled) { m_persistent_saves = enabled; }
+
+auto Cartridge::Valid() const -> bool { return (!!m_mapper) && (m_mapper->Valid()); }
+
+auto Cartridge::GetInfo() const -> Info const& { return m_info; }
 
-auto Cartridge::GetInfo() -> Info const& { return m_info; }
+auto Cartridge::GetMirrorMode() -> MirrorMode {
+  if (m_info.mirror_mode != MirrorMode::Dynamic) return m_info.mirror_mode;
+  return m_mapper->VerticalMirroring() ? MirrorMode::Vertical : MirrorMode::Horizontal;
+}
 
 auto Cartridge::CpuRead(addr_t addr) -> byte_t { return m_mapper->CpuRead(addr); }
 void Cartridge::CpuWrite(addr_t addr, byte_t value) { m_mapper->CpuWrite(addr, value); }
@@ -42,10 +43,66 @@ void Cartridge::CpuWrite(addr_t addr, byte_t value) { m_mapper->CpuWrite(addr, v
 auto Cartridge::PpuRead(addr_t addr) -> byte_t { return m_mapper->PpuRead(addr); }
 void Cartridge::PpuWrite(addr_t addr, byte_t value) { m_mapper->PpuWrite(addr, value); }
 
+auto Cartridge::ProgramOffset(addr_t addr) const -> size_t { return m_mapper->ProgramOffset(addr); }
+
+auto Cartridge::ReadProgramRam(addr_t addr) const -> byte_t {
+  return m_prg_ram.Empty() ? 0 : m_prg_ram.Read(addr - 0x6000);
+}
+
+void Cartridge::WriteProgramRam(addr_t addr, byte_t value) {
+  if (!m_prg_ram.Empty()) m_prg_ram.Write(addr - 0x6000, value);
+}
+
+auto Cartridge::CountsScanlines() -> bool { return m_mapper && m_mapper->CountsScanlines(); }
+auto Cartridge::ClockScanline() -> bool { return m_mapper->ClockScanline(); }
+auto Cartridge::IrqPending() const -> bool { return m_mapper && m_mapper->IrqPending(); }
+auto Cartridge::ObserveA12(bool high, std::uint64_t dot) -> bool {
+  return m_mapper->ObserveA12(high, dot);
+}
+
+void Cartridge::EndFrame() { m_prg_ram.EndFrame(); }
+
+void Cartridge::SaveState(State& state) const {
+  state.mapper_id = m_info.mapper_id;
+  if (m_mapper) m_mapper->SaveState(state.mapper);
+  m_prg_ram.CopyTo(state.prg_ram.data(), state.prg_ram.size());
+}
+
+auto Cartridge::LoadState(State const& state) -> bool {
+  if (!m_mapper || state.mapper_id != m_info.mapper_id) return false;
+  m_mapper->LoadState(state.mapper);
+  m_prg_ram.CopyFrom(state.prg_ram.data(), state.prg_ram.size());
+  return true;
+}
+
 // ----------------------------------------------
 // Private member function definitions
 // ----------------------------------------------
 
+auto Cartridge::LoadContents(string const& file, std::vector<byte_t> const& contents,
+                             bool persistent) -> bool {
+  m_mapper.reset();
+  m_prg_ram.Release();
+
+  if (contents.size() <= 16) {
+    LOG_INFO("... File '" + file + "' is not a valid NES file");
+    return false;
+  }
+
+  if (!Validate(contents)) {
+    LOG_INFO("... File '" + file + "' is not a valid NES file");
+    return false;
+  }
+
+  if (!ParseContents(contents)) return false;
+  m_info.hash = Fnv1a(contents.data(), contents.size());
+
+  auto save_file = string{};
+  if (persistent) save_file = std::filesystem::path{file}.replace_extension(".sav").string();
+  AllocateProgramRam(contents, GetFileFormat(contents), save_file);
+  return Valid();
+}
+
 auto Cartridge::Validate(std::vector<byte_t> const& contents) -> bool {
   return (contents[0] == 'N' && contents[1] == 'E' && contents[2] == 'S' && contents[3] == '\x1A');
 }
@@ -56,7 +113,11 @@ auto Cartridge::ParseContents(std::vector<byte_t> const& contents) -> bool {
 
   GetMapper(contents, format);
   m_info.mirror_mode = GetMirroringMode(contents);
+  m_info.battery = contents[6] & 0x02;
   if (m_mapper) {
+    if (m_mapper->DynamicMirroring() && m_info.mirror_mode != MirrorMode::FourScreen) {
+      m_info.mirror_mode = MirrorMode::Dynamic;
+    }
     return FillRom(contents, format);
   } else {
     return false;
@@ -150,4 +211,30 @@ auto Cartridge::FillRom(std::vector<byte_t> const& contents, Format format) -> b
   return true;
 }
 
-}  // namespace nes
\ No newline at end of file
+void Cartridge::AllocateProgramRam(std::vector<byte_t> const& contents, Format format,
+                                   string const& save_file) {
+  // iNES gives the size in 8 KiB units (0 meaning 8 KiB for compatibility); NES 2.0 gives separate
+  // volatile and battery-backed shift counts, of which we only need the larger
+  auto size = size_t{0x2000};
+  if (format == Format::Nes_v2) {
+    auto shift = std::max(contents[10] & 0x0F, contents[10] >> 4);
+    if (shift != 0) size = size_t{64} << shift;
+  } else if (contents[8] != 0) {
+    size = size_t{0x2000} * contents[8];
+  }
+
+  // none of the supported mappers bank PRG-RAM, so anything beyond the 8 KiB window is unreachable
+  size = std::min(size, size_t{0x2000});
+  m_info.prg_ram_size = size;
+
+  LOG_DEBUG("... Program RAM size = " + std::to_string(size >> 10) + " KiB" +
+            (m_info.battery ? " (battery-backed)" : ""));
+
+  if (m_info.battery && !save_file.empty()) {
+    if (m_prg_ram.Map(save_file, size)) return;
+  }
+
+  m_prg_ram.Allocate(size);
+}
+
+}  // namespace nes
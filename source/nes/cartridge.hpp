@@ -1,12 +1,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <filesystem>
 #include <fstream>
 #include <tuple>
 #include <vector>
 
 #include "nes/common.hpp"
 #include "nes/mappers.hpp"
+#include "nes/save_ram.hpp"
+#include "nes/utility.hpp"
 
 namespace nes {
 
@@ -32,18 +36,33 @@ public:
     Ntsc,
   };
 
+  struct State {
+    uint mapper_id;
+    Mapper::State mapper;
+    std::array<byte_t, 0x2000> prg_ram;
+  };
+
   struct Info {
     uint mapper_id = 0;
     uint submapper_id = 0;
     MirrorMode mirror_mode = MirrorMode::Unknown;
     TvSystem tv_system = TvSystem::Unknown;
+    bool battery = false;
+    size_t prg_ram_size = 0;
+    std::uint64_t hash = 0;  // of the whole file, header included
   };
 
+  // Battery-backed PRG-RAM is kept in a .sav file next to the ROM file, unless persistent saves
+  // are turned off (for test runs). ROMs loaded from memory have no file to keep it next to, so
+  // their PRG-RAM is always volatile.
   auto Load(string const& file) -> bool;
+  auto Load(string const& name, std::vector<byte_t> const& contents) -> bool;
+  void SetPersistentSaves(bool enabled);
   
-  auto Valid() -> bool;
+  auto Valid() const -> bool;
 
-  auto GetInfo() -> Info const&;
+  auto GetInfo() const -> Info const&;
+  auto GetMirrorMode() -> MirrorMode;
 
   auto CpuRead(addr_t addr) -> byte_t;
   void CpuWrite(addr_t addr, byte_t value);
@@ -51,16 +70,37 @@ public:
   auto PpuRead(addr_t addr) -> byte_t;
   void PpuWrite(addr_t addr, byte_t value);
 
+  auto ProgramOffset(addr_t addr) const -> size_t;
+
+  auto ReadProgramRam(addr_t addr) const -> byte_t;
+  void WriteProgramRam(addr_t addr, byte_t value);
+
+  auto CountsScanlines() -> bool;
+  auto ClockScanline() -> bool;
+  auto ObserveA12(bool high, std::uint64_t dot) -> bool;
+  auto IrqPending() const -> bool;
+
+  void EndFrame();
+
+  void SaveState(State& state) const;
+  auto LoadState(State const& state) -> bool;
+
 private:
   Info m_info;
   std::unique_ptr<Mapper> m_mapper;
+  SaveRam m_prg_ram;
+  bool m_persistent_saves = true;
 
+  auto LoadContents(string const& file, std::vector<byte_t> const& contents, bool persistent)
+      -> bool;
   auto Validate(std::vector<byte_t> const& contents) -> bool;
   auto ParseContents(std::vector<byte_t> const& contents) -> bool;
   auto GetFileFormat(std::vector<byte_t> const& contents) -> Format;
   auto GetMirroringMode(std::vector<byte_t> const& contents) -> MirrorMode;
   void GetMapper(std::vector<byte_t> const& contents, Format format);
   auto FillRom(std::vector<byte_t> const& contents, Format format) -> bool;
+  void AllocateProgramRam(std::vector<byte_t> const& contents, Format format,
+                          string const& save_file);
 };
 
 }  // namespace nes
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "nes/logger.hpp"
+#include "nes/trace.hpp"
 
 namespace nes {
 
@@ -15,6 +16,7 @@ using std::size_t;
 using std::string;
 
 // forward declarations
+class Apu;
 class Bus;
 class Cartridge;
 class Cpu;
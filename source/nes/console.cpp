@@ -3,11 +3,13 @@
 namespace nes {
 
 Console::Console() {
+  m_bus.AttachApu(&m_apu);
   m_bus.AttachCpu(&m_cpu);
   m_bus.AttachPpu(&m_ppu);
   m_bus.AttachCartridge(&m_cartridge);
   
   m_cpu.AttachBus(&m_bus);
+  m_apu.AttachBus(&m_bus);
 
   m_ppu.AttachBus(&m_bus);
   m_ppu.AttachCartridge(&m_cartridge);
@@ -15,27 +17,52 @@ Console::Console() {
 }
 
 void Console::Load(string const& file) {
+  TRACE_ZONE("Console::Load");
   Pause();
-  if (m_cartridge.Load(file)) {
-    m_cpu.Reset();
-    Unpause();
-  } else {
-    LOG_INFO("Failed to load NES file");
+  Boot(m_cartridge.Load(file));
+}
+
+void Console::Load(string const& name, std::vector<byte_t> const& contents) {
+  TRACE_ZONE("Console::Load");
+  Pause();
+  Boot(m_cartridge.Load(name, contents));
+}
+
+void Console::SetPersistentSaves(bool enabled) { m_cartridge.SetPersistentSaves(enabled); }
+
+auto Console::Send(Command command) -> bool {
+  if (!m_commands.Push(std::move(command))) {
+    LOG_WARN("Console command queue is full; dropping command");
+    return false;
   }
+
+  // the lock orders this notification against WaitForCommand checking the queue, so a paused
+  // console can't miss the wake-up
+  { std::lock_guard lock{m_wake_mutex}; }
+  m_wake.notify_one();
+  return true;
 }
 
 auto Console::Run() -> int {
-  using namespace std::literals;
+  auto was_paused = true;
+  auto was_fast = false;
+  while (true) {
+    ApplyCommands();
+    if (!m_running) break;
 
-  while (m_running) {
-    if (!m_paused) {
-      m_cpu.Step();
-      m_ppu.Step();
-      m_ppu.Step();
-      m_ppu.Step();
-    } else {
-      std::this_thread::sleep_for(10ms);
+    if (m_paused) {
+      was_paused = true;
+      WaitForCommand();
+      continue;
     }
+
+    if (was_paused || (was_fast && !m_fast_forward)) m_pacer.Reset();
+    if (was_paused) m_perf.Restart();
+    was_paused = false;
+    was_fast = m_fast_forward;
+
+    m_rewinding ? StepBack() : EmulateFrame();
+    if (m_paced && !was_fast) m_pacer.Wait();
   }
 
   return 0;
@@ -49,15 +76,411 @@ void Console::Reset() {
   Pause();
   m_cpu.Reset();
   m_ppu.Reset();
+  m_apu.Reset();
 }
 
 void Console::ForceCpuInitPc(addr_t pc) {
   m_cpu.SetProgramCounter(pc);
 }
 
+void Console::StepFrame() { EmulateFrame(); }
+
+auto Console::GetCycleCount() const -> std::uint64_t { return m_cycles; }
+
+void Console::SaveState(Snapshot& snapshot) const {
+  snapshot = Snapshot{};
+  snapshot.cycles = m_cycles;
+  m_cpu.SaveState(snapshot.cpu);
+  m_ppu.SaveState(snapshot.ppu);
+  m_apu.SaveState(snapshot.apu);
+  m_bus.SaveState(snapshot.bus);
+  m_cartridge.SaveState(snapshot.cartridge);
+}
+
+auto Console::LoadState(Snapshot const& snapshot) -> bool {
+  if (!RestoreState(snapshot)) return false;
+
+  if (m_movie_mode == MovieMode::Playing) m_movie_mode = MovieMode::Off;
+  if (m_movie_mode == MovieMode::Recording) {
+    LOG_WARN("Loaded a state while recording; the movie will not replay past this point");
+  }
+
+  // frames recorded since the snapshot was taken belong to a timeline that no longer exists
+  if (m_rewind) m_rewind->Clear();
+  return true;
+}
+
+void Console::SaveStateToFile(string const& file) {
+  if (!m_snapshot_writer) m_snapshot_writer = std::make_unique<SnapshotWriter>();
+  m_snapshot_writer->Submit(file, [this](Snapshot& snapshot) { SaveState(snapshot); });
+}
+
+auto Console::LoadStateFromFile(string const& file) -> bool {
+  auto snapshot = std::make_unique<Snapshot>();
+  return SnapshotWriter::Read(file, *snapshot) && LoadState(*snapshot);
+}
+
+void Console::EnableRewind(size_t budget) {
+  if (budget == 0) {
+    m_rewinding = false;
+    m_rewind.reset();
+    m_frame_snapshot.reset();
+    return;
+  }
+
+  m_rewind = std::make_unique<RewindBuffer>(budget);
+  m_frame_snapshot = std::make_unique<Snapshot>();
+  LOG_DEBUG("Rewind enabled with a budget of " + std::to_string(m_rewind->Budget() >> 10) +
+            " KiB");
+}
+
+auto Console::Rewind(size_t frames) -> bool {
+  // the movie can't represent a rewind to before it started
+  if (m_movie_mode == MovieMode::Recording && frames > m_movie->inputs.size()) return false;
+
+  if (!m_rewind || !m_rewind->Rewind(frames, *m_frame_snapshot) ||
+      !RestoreState(*m_frame_snapshot)) {
+    return false;
+  }
+
+  if (m_movie_mode == MovieMode::Playing) m_movie_mode = MovieMode::Off;
+  if (m_movie_mode == MovieMode::Recording) {
+    m_movie->inputs.resize(m_movie->inputs.size() - frames);
+  }
+  return true;
+}
+
+void Console::SetRewinding(bool enabled) { m_rewinding = enabled && m_rewind; }
+
+void Console::SetInput(uint port, byte_t buttons) {
+  m_bus.GetControllers().Publish(port, buttons);
+}
+
+void Console::StartRecording() {
+  m_movie = std::make_unique<Movie>();
+  m_movie->rom_hash = m_cartridge.GetInfo().hash;
+  SaveState(*m_movie->start);
+  m_movie_mode = MovieMode::Recording;
+}
+
+auto Console::StopRecording(string const& file) -> bool {
+  if (m_movie_mode != MovieMode::Recording) return false;
+  m_movie_mode = MovieMode::Off;
+  return m_movie->Save(file);
+}
+
+auto Console::PlayMovie(string const& file) -> bool {
+  auto movie = std::make_unique<Movie>();
+  if (!movie->Load(file)) return false;
+
+  if (movie->rom_hash != m_cartridge.GetInfo().hash) {
+    LOG_WARN("Movie '" + file + "' was recorded with a different ROM");
+    return false;
+  }
+  if (!LoadState(*movie->start)) return false;
+
+  m_movie = std::move(movie);
+  m_movie_frame = 0;
+  m_movie_mode = m_movie->inputs.empty() ? MovieMode::Off : MovieMode::Playing;
+  return true;
+}
+
+auto Console::PlayingMovie() const -> bool { return m_movie_mode == MovieMode::Playing; }
+
+void Console::SetRunAhead(uint frames) {
+  m_run_ahead = frames;
+  m_run_ahead_cost_us = 0.0;
+  if (frames > 0 && !m_run_ahead_snapshot) m_run_ahead_snapshot = std::make_unique<Snapshot>();
+}
+
+auto Console::GetRunAheadCost() const -> double { return m_run_ahead_cost_us; }
+
+void Console::SetSpeed(double multiplier) {
+  m_paced = multiplier > 0.0;
+  if (m_paced) m_pacer.SetFrameRate(multiplier * FramePacer::ntsc_frame_rate);
+}
+
+auto Console::GetFrameJitter() const -> FramePacer::Jitter { return m_pacer.GetJitter(); }
+
+void Console::SetVideo(Video mode) {
+  m_video = mode;
+  m_next_drawn_frame = {};
+}
+
+void Console::SetFastForward(bool enabled) { m_fast_forward = enabled; }
+
+void Console::EnableStats(bool enabled) {
+  if (enabled && !m_stats) m_perf.Restart();
+  m_stats = enabled;
+}
+
+auto Console::GetStats() const -> PerfStats { return m_perf.Get(); }
+
+void Console::SetFrameCallback(std::function<void(Display const&)> callback) {
+  m_frame_callback = std::move(callback);
+}
+
+auto Console::StartCapture(string const& video_file, string const& audio_file) -> bool {
+  m_next_drawn_frame = {};
+  return m_capture.Open(video_file, audio_file);
+}
+
+auto Console::StopCapture() -> bool { return m_capture.Close(); }
+
+auto Console::GetBusProfiler() const -> Bus::Profiler const& { return m_bus.GetProfiler(); }
+
+auto Console::HashFrame() const -> FrameHashes {
+  TRACE_ZONE("Console::HashFrame");
+  auto hashes = FrameHashes{};
+  hashes.display = Hash64(m_display.GetRawPixelBuffer(), Display::Width() * Display::Height() * 3);
+
+  // field by field, so padding never makes it in
+  auto const& reg = m_cpu.GetRegisters();
+  byte_t cpu[15] = {static_cast<byte_t>(reg.pc), static_cast<byte_t>(reg.pc >> 8), reg.a, reg.x,
+                    reg.y, reg.s, reg.p};
+  for (auto i = 0; i < 8; ++i) cpu[7 + i] = static_cast<byte_t>(m_cycles >> (8 * i));
+  hashes.cpu = Hash64(cpu, sizeof(cpu));
+
+  auto const& ram = m_bus.GetRam();
+  hashes.ram = Hash64(ram.data(), ram.size());
+
+  auto ppu = Ppu::State{};
+  m_ppu.SaveState(ppu);
+  std::uint64_t vram[] = {Hash64(ppu.pattern_tables.data(), sizeof(ppu.pattern_tables)),
+                          Hash64(ppu.name_tables.data(), sizeof(ppu.name_tables)),
+                          Hash64(ppu.palette_table.data(), ppu.palette_table.size())};
+  hashes.vram = Hash64(vram, sizeof(vram));
+  static_assert(sizeof(Ppu::Sprite) == 4);
+  hashes.oam = Hash64(ppu.sprites.data(), sizeof(ppu.sprites));
+  return hashes;
+}
+
+auto Console::RestoreState(Snapshot const& snapshot) -> bool {
+  if (!snapshot.Valid() || !m_cartridge.LoadState(snapshot.cartridge)) {
+    LOG_WARN("Snapshot does not match the loaded cartridge");
+    return false;
+  }
+
+  m_cycles = snapshot.cycles;
+  m_cpu.LoadState(snapshot.cpu);
+  m_ppu.LoadState(snapshot.ppu);
+  m_apu.LoadState(snapshot.apu);
+  m_bus.LoadState(snapshot.bus);
+  return true;
+}
+
 auto Console::GetCpu() const -> Cpu const& { return m_cpu; }
 auto Console::GetPpu() const -> Ppu const& { return m_ppu; }
 auto Console::GetCartridge() const -> Cartridge const& { return m_cartridge; }
 auto Console::GetDisplay() const -> Display const& { return m_display; }
+auto Console::GetAudio() -> SampleRing& { return m_audio; }
+auto Console::GetRam() const -> std::array<byte_t, 0x0800> const& { return m_bus.GetRam(); }
+
+void Console::ApplyCommands() {
+  TRACE_ZONE("Console::ApplyCommands");
+  auto command = Command{};
+  while (m_commands.Pop(command)) {
+    switch (command.type) {
+    case Command::Type::Pause: Pause(); break;
+    case Command::Type::Unpause: Unpause(); break;
+    case Command::Type::TogglePause: TogglePause(); break;
+    case Command::Type::PowerOff: PowerOff(); break;
+    case Command::Type::Load: Load(command.file); break;
+    case Command::Type::FastForward: SetFastForward(command.enabled); break;
+    case Command::Type::Rewind: SetRewinding(command.enabled); break;
+    case Command::Type::Stats: EnableStats(command.enabled); break;
+    case Command::Type::FrameCallback: SetFrameCallback(std::move(command.callback)); break;
+    }
+  }
+}
+
+// Goes back two frames and runs one of them again, so that there is a freshly drawn frame to show
+// (and audio to play) for the frame it lands on. Holds on the oldest frame once history runs out.
+void Console::StepBack() {
+  TRACE_ZONE("Console::StepBack");
+  if (Rewind(2)) EmulateFrame();
+}
+
+void Console::WaitForCommand() {
+  TRACE_ZONE("Console::WaitForCommand");
+  auto lock = std::unique_lock{m_wake_mutex};
+  m_wake.wait(lock, [this] { return !m_commands.Empty(); });
+}
+
+void Console::Boot(bool loaded) {
+  if (m_rewind) m_rewind->Clear();
+  m_bus.GetProfiler().Reset();
+  if (loaded) {
+    m_cpu.Reset();
+    Unpause();
+  } else {
+    LOG_INFO("Failed to load NES file");
+  }
+}
+
+void Console::EmulateFrame() {
+  TRACE_ZONE("Console::EmulateFrame");
+  if (m_stats) m_perf.BeginFrame(m_cycles, m_cpu.GetInstructionCount());
+  LatchInput();
+
+  auto draw = DrawThisFrame();
+  if (m_run_ahead == 0 || m_fast_forward) {
+    m_ppu.SetOutputEnabled(draw);
+    RunFrame();
+    EndFrame();
+  } else {
+    // the real frame is never shown - the last frame run ahead replaces it
+    m_ppu.SetOutputEnabled(false);
+    RunFrame();
+    EndFrame();
+    RunAhead(draw);
+  }
+  if (draw && m_frame_callback) {
+    // the handoff to the frontend, which copies the frame out before returning
+    TRACE_ZONE("Console::FrameCallback");
+    m_frame_callback(m_display);
+  }
+  m_capture.AddFrame(draw ? &m_display : nullptr, m_apu.GetFrameSamples(),
+                     m_apu.GetFrameSampleCount());
+  if (m_stats) m_perf.EndFrame(m_cycles, m_cpu.GetInstructionCount());
+}
+
+void Console::LatchInput() {
+  auto& controllers = m_bus.GetControllers();
+  switch (m_movie_mode) {
+  case MovieMode::Off: controllers.Unlock(); break;
+  case MovieMode::Recording: {
+    auto input = Movie::Input{controllers.Live(0), controllers.Live(1)};
+    controllers.Lock(input);
+    m_movie->inputs.push_back(input);
+    break;
+  }
+  case MovieMode::Playing:
+    controllers.Lock(m_movie->inputs[m_movie_frame++]);
+    if (m_movie_frame == m_movie->inputs.size()) {
+      LOG_INFO("Movie finished after " + std::to_string(m_movie_frame) + " frames");
+      m_movie_mode = MovieMode::Off;
+    }
+    break;
+  }
+}
+
+auto Console::DrawThisFrame() -> bool {
+  using Clock = std::chrono::steady_clock;
+  constexpr auto refresh_interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>{1.0 / FramePacer::ntsc_frame_rate});
+
+  if (m_capture.HasVideo()) return true;
+  switch (m_video) {
+  case Video::None: return false;
+  case Video::All:
+    if (!m_fast_forward) return true;
+    [[fallthrough]];
+  case Video::Frameskip: {
+    // the display can't show frames any faster than it refreshes, so don't draw the ones in between
+    auto now = Clock::now();
+    if (now < m_next_drawn_frame) return false;
+    m_next_drawn_frame = now + refresh_interval;
+    return true;
+  }
+  }
+  return true;
+}
+
+void Console::RunAhead(bool draw) {
+  TRACE_ZONE("Console::RunAhead");
+  using Clock = std::chrono::steady_clock;
+
+  auto start = Clock::now();
+  SaveState(*m_run_ahead_snapshot);
+  m_apu.SetOutputEnabled(false);
+  m_bus.GetProfiler().SetPaused(true);
+  for (auto i = 1u; i <= m_run_ahead; ++i) {
+    m_ppu.SetOutputEnabled(draw && i == m_run_ahead);
+    RunFrame();
+  }
+  m_bus.GetProfiler().SetPaused(false);
+  m_apu.SetOutputEnabled(true);
+  RestoreState(*m_run_ahead_snapshot);
+
+  auto cost = std::chrono::duration<double, std::micro>{Clock::now() - start}.count();
+  m_run_ahead_cost_us += (cost - m_run_ahead_cost_us) / 16.0;
+}
+
+void Console::RunFrame() {
+  TRACE_ZONE("Console::RunFrame");
+  if (m_stats) return RunFrameSampled();
+
+  auto frame = m_ppu.FrameCount();
+  while (m_running && !m_paused && m_ppu.FrameCount() == frame) {
+    m_cpu.Step();
+    m_apu.Tick();
+    m_ppu.Step();
+    m_ppu.Step();
+    m_ppu.Step();
+    ++m_cycles;
+  }
+}
+
+// RunFrame, timing one CPU cycle in every PerfCounters::sample_period
+void Console::RunFrameSampled() {
+  TRACE_ZONE("Console::RunFrameSampled");
+  using Clock = PerfCounters::Clock;
+  constexpr auto sample_mask = PerfCounters::sample_period - 1;
+
+  auto start = Clock::now();
+  auto frame = m_ppu.FrameCount();
+  while (m_running && !m_paused && m_ppu.FrameCount() == frame) {
+    if ((m_cycles & sample_mask) != 0) {
+      m_cpu.Step();
+      m_apu.Tick();
+      m_ppu.Step();
+      m_ppu.Step();
+      m_ppu.Step();
+    } else {
+      auto t0 = Clock::now();
+      m_cpu.Step();
+      auto t1 = Clock::now();
+      m_apu.Tick();
+      auto t2 = Clock::now();
+      m_ppu.Step();
+      m_ppu.Step();
+      m_ppu.Step();
+      m_perf.AddSample(t0, t1, t2, Clock::now());
+    }
+    ++m_cycles;
+  }
+  m_perf.AddSteps(Clock::now() - start);
+}
+
+void Console::EndFrame() {
+  TRACE_ZONE("Console::EndFrame");
+  auto start = m_stats ? PerfCounters::Clock::now() : PerfCounters::Clock::time_point{};
+  m_cartridge.EndFrame();
+  m_apu.EndFrame(m_audio);
+  m_bus.GetProfiler().EndFrame();
+
+  if (m_rewind) {
+    SaveState(*m_frame_snapshot);
+    m_rewind->Push(*m_frame_snapshot);
+  }
+
+  if (m_paced && m_ppu.FrameCount() % 600 == 0) {
+    LOG_DEBUG(([&] {
+      auto jitter = m_pacer.GetJitter();
+      return "[PACER] Frame lateness (us) p50: " + std::to_string(jitter.p50_us) +
+             " | p90: " + std::to_string(jitter.p90_us) +
+             " | p99: " + std::to_string(jitter.p99_us) +
+             " | max: " + std::to_string(jitter.max_us);
+    }()));
+  }
+
+  if (m_run_ahead > 0 && m_ppu.FrameCount() % 600 == 0) {
+    LOG_DEBUG("[RUN-AHEAD] " + std::to_string(m_run_ahead) + " frame(s) cost " +
+              std::to_string(m_run_ahead_cost_us) + " us per frame");
+  }
+
+  if (m_stats) m_perf.AddEndFrame(PerfCounters::Clock::now() - start);
+}
 
 }  // namespace nes
\ No newline at end of file
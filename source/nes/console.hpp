@@ -1,14 +1,27 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 
+#include "nes/apu.hpp"
 #include "nes/bus.hpp"
+#include "nes/capture.hpp"
 #include "nes/cartridge.hpp"
 #include "nes/cpu.hpp"
 #include "nes/display.hpp"
+#include "nes/frame_pacer.hpp"
+#include "nes/hash.hpp"
+#include "nes/movie.hpp"
+#include "nes/perf_counters.hpp"
 #include "nes/ppu.hpp"
+#include "nes/rewind.hpp"
+#include "nes/sample_ring.hpp"
+#include "nes/snapshot.hpp"
+#include "nes/spsc_queue.hpp"
 
 namespace nes {
 
@@ -17,6 +30,36 @@ public:
   Console();
 
   void Load(string const& file);
+  void Load(string const& name, std::vector<byte_t> const& contents);
+
+  // Whether battery-backed RAM is kept in a .sav file next to the ROM (see Cartridge::Load). On by
+  // default; test runners turn it off so that they leave nothing behind. Takes effect at the next
+  // Load.
+  void SetPersistentSaves(bool enabled);
+
+  // Everything else below must be called on the thread running the console (or while nothing is
+  // running it). Other threads control the console by sending commands instead: they go through a
+  // lock-free queue that Run() drains between frames, and a paused console sleeps until the next
+  // command arrives rather than polling. Only one thread may send commands.
+  struct Command {
+    enum class Type {
+      Pause,
+      Unpause,
+      TogglePause,
+      PowerOff,
+      Load,
+      FastForward,
+      Rewind,
+      Stats,
+      FrameCallback,
+    };
+
+    Type type = Type::Pause;
+    string file = {};                                   // Load
+    bool enabled = false;                               // FastForward, Rewind, Stats
+    std::function<void(Display const&)> callback = {};  // FrameCallback
+  };
+  auto Send(Command command) -> bool;  // false if the queue is full
 
   auto Run() -> int;
   void Pause();
@@ -27,20 +70,148 @@ public:
 
   void ForceCpuInitPc(addr_t pc);
 
+  // runs a single frame on the calling thread, ignoring pacing - for headless frontends
+  void StepFrame();
+  auto GetCycleCount() const -> std::uint64_t;
+
+  // Snapshots must be taken and restored between frames, on the thread running the console. Saving
+  // to a file only copies the state; the write happens on a background thread.
+  void SaveState(Snapshot& snapshot) const;
+  auto LoadState(Snapshot const& snapshot) -> bool;
+  void SaveStateToFile(string const& file);
+  auto LoadStateFromFile(string const& file) -> bool;
+
+  // Records a snapshot at the end of every frame, keeping as many frames as fit in `budget` bytes.
+  // A budget of 0 turns rewinding off.
+  void EnableRewind(size_t budget);
+  auto Rewind(size_t frames) -> bool;
+
+  // While held, Run() plays the history backwards, one frame per paced frame, and stops on the
+  // oldest frame kept. Does nothing with rewinding off.
+  void SetRewinding(bool enabled);
+
+  // Publishes a pad's buttons (see Controllers for the bit layout). Safe to call from any thread;
+  // the game sees the new buttons at its next controller strobe.
+  void SetInput(uint port, byte_t buttons);
+
+  // Recording starts from a snapshot of the current state and captures the input of every frame
+  // after it; while recording or replaying, the controllers see one fixed input per frame.
+  // Rewinding while recording drops the rewound frames from the movie; replay stops if the user
+  // rewinds or loads a state.
+  void StartRecording();
+  auto StopRecording(string const& file) -> bool;
+  auto PlayMovie(string const& file) -> bool;
+  auto PlayingMovie() const -> bool;
+
+  // Runs `frames` frames ahead of the real emulation each frame and shows the last of them, then
+  // rolls back. Hides that many frames of the game's own input latency at the cost of emulating
+  // frames + 1 frames per displayed frame. 0 turns run-ahead off.
+  void SetRunAhead(uint frames);
+  auto GetRunAheadCost() const -> double;  // average host microseconds per frame
+
+  // emulation speed relative to a real NTSC console; 0 runs uncapped
+  void SetSpeed(double multiplier);
+  auto GetFrameJitter() const -> FramePacer::Jitter;
+
+  // Which frames the PPU draws. Skipped frames still run everything in the PPU the CPU can
+  // observe (status flags, NMI, mapper IRQ timing) and only drop the pixel output. Frameskip draws
+  // about one frame per NTSC refresh of host time; None never draws, for RAM-only batch runs.
+  enum class Video { All, Frameskip, None };
+  void SetVideo(Video mode);
+
+  // runs uncapped without run-ahead, drawing with frameskip unless video is off entirely
+  void SetFastForward(bool enabled);
+
+  // Per-frame performance counters; see PerfCounters. Off by default, and free while off.
+  // GetStats may be called from any thread and returns the last published frame's counters.
+  void EnableStats(bool enabled);
+  auto GetStats() const -> PerfStats;
+
+  // Counts of every CPU bus access since the last ROM was loaded, in builds configured with
+  // RENES_ENABLE_BUS_PROFILER=ON; see BusProfiler. Frames run ahead aren't counted.
+  auto GetBusProfiler() const -> Bus::Profiler const&;
+
+  // Called on the console thread as soon as each drawn frame is complete, with the frame (the
+  // last frame run ahead, with run-ahead on). Frontends copy it out and hand it to their own
+  // thread; they must not hold on to the reference.
+  void SetFrameCallback(std::function<void(Display const&)> callback);
+
+  // Streams every frame from now on to a YUV4MPEG2 video file and its audio to a WAV file; either
+  // may be empty, and "-" is standard output. See Capture. Every frame is drawn while video is
+  // being captured, whatever the video mode.
+  auto StartCapture(string const& video_file, string const& audio_file) -> bool;
+  auto StopCapture() -> bool;
+
+  // Hashes of the current frame and of the state the frames after it follow from, for checking a
+  // run against a known good one frame by frame; see Hash64. Only computed when asked for, which
+  // takes about as long as emulating a few scanlines.
+  struct FrameHashes {
+    std::uint64_t display;
+    std::uint64_t cpu;   // registers and cycle count
+    std::uint64_t ram;
+    std::uint64_t vram;  // pattern table RAM, name tables and palette
+    std::uint64_t oam;
+  };
+  auto HashFrame() const -> FrameHashes;
+
   // read-only access to internal components
   auto GetCpu() const -> Cpu const&;
   auto GetPpu() const -> Ppu const&;
   auto GetCartridge() const -> Cartridge const&;
   auto GetDisplay() const -> Display const&;
 
+  // 48 kHz mono samples, written at the end of every frame; one consumer may read them from any
+  // thread, and whatever it doesn't keep up with is dropped
+  auto GetAudio() -> SampleRing&;
+  auto GetRam() const -> std::array<byte_t, 0x0800> const&;
+
 private:
   bool m_running = true;
   bool m_paused = true;
+  bool m_paced = true;
+  bool m_fast_forward = false;
+  bool m_rewinding = false;
+  bool m_stats = false;
+  Video m_video = Video::All;
+  std::function<void(Display const&)> m_frame_callback = {};
+  std::chrono::steady_clock::time_point m_next_drawn_frame = {};
+  std::uint64_t m_cycles = 0;
   Bus m_bus = {};
   Cpu m_cpu = {};
   Ppu m_ppu = {};
+  Apu m_apu = {};
   Cartridge m_cartridge = {};
   Display m_display = {};
+  SampleRing m_audio{1 << 14};
+  FramePacer m_pacer = {};
+  PerfCounters m_perf = {};
+  Capture m_capture = {};
+  std::unique_ptr<SnapshotWriter> m_snapshot_writer = nullptr;
+  std::unique_ptr<RewindBuffer> m_rewind = nullptr;
+  std::unique_ptr<Snapshot> m_frame_snapshot = nullptr;
+  std::unique_ptr<Snapshot> m_run_ahead_snapshot = nullptr;
+  enum class MovieMode { Off, Recording, Playing } m_movie_mode = MovieMode::Off;
+  std::unique_ptr<Movie> m_movie = nullptr;
+  size_t m_movie_frame = 0;
+  uint m_run_ahead = 0;
+  double m_run_ahead_cost_us = 0.0;
+
+  SpscQueue<Command, 64> m_commands = {};
+  std::mutex m_wake_mutex;
+  std::condition_variable m_wake;
+
+  void Boot(bool loaded);
+  void ApplyCommands();
+  void StepBack();
+  void WaitForCommand();
+  void EmulateFrame();
+  void LatchInput();
+  void RunFrame();
+  void RunFrameSampled();
+  void RunAhead(bool draw);
+  auto DrawThisFrame() -> bool;
+  void EndFrame();
+  auto RestoreState(Snapshot const& snapshot) -> bool;
 };
 
 }  // namespace nes
\ No newline at end of file
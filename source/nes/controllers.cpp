@@ -0,0 +1,50 @@
+#include "nes/controllers.hpp"
+
+namespace nes {
+
+void Controllers::Lock(std::array<byte_t, 2> const& input) {
+  m_locked_input = input;
+  m_locked = true;
+}
+
+void Controllers::Unlock() { m_locked = false; }
+
+auto Controllers::Read(uint port) -> byte_t {
+  // while strobe is high the shift register keeps reloading, so only A is ever read
+  if (m_strobe) Latch();
+
+  // official pads return 1s once all 8 buttons have been read
+  auto bit = static_cast<byte_t>(m_shift[port] & 0x01);
+  m_shift[port] = static_cast<byte_t>((m_shift[port] >> 1) | 0x80);
+
+  // the upper bits are open bus, which is almost always the high byte of $4016/$4017
+  return 0x40 | bit;
+}
+
+void Controllers::Write(byte_t value) {
+  auto strobe = TestBit(value, 0);
+  if (m_strobe || strobe) Latch();
+  m_strobe = strobe;
+}
+
+void Controllers::SaveState(State& state) const {
+  state.shift = m_shift;
+  state.locked_input = m_locked_input;
+  state.strobe = m_strobe;
+  state.locked = m_locked;
+}
+
+void Controllers::LoadState(State const& state) {
+  m_shift = state.shift;
+  m_locked_input = state.locked_input;
+  m_strobe = state.strobe;
+  m_locked = state.locked;
+}
+
+void Controllers::Latch() {
+  for (auto port = 0u; port < m_shift.size(); ++port) {
+    m_shift[port] = m_locked ? m_locked_input[port] : Live(port);
+  }
+}
+
+}  // namespace nes
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "nes/common.hpp"
+#include "nes/utility.hpp"
+
+namespace nes {
+
+// The two standard controller ports at $4016/$4017.
+//
+// The host publishes each pad's buttons as a single atomic byte (A, B, Select, Start, Up, Down,
+// Left, Right from bit 0 up) from whichever thread handles input. The game's strobe write latches
+// that byte straight into the shift registers, so a key press is visible to the very next poll
+// without any locking. Movies need every frame to see one fixed input instead, so the ports can
+// be locked to a per-frame value while recording or replaying.
+class Controllers {
+public:
+  struct State {
+    std::array<byte_t, 2> shift;
+    std::array<byte_t, 2> locked_input;
+    bool strobe;
+    bool locked;
+  };
+
+  // any thread
+  void Publish(uint port, byte_t buttons) {
+    m_live.at(port).store(buttons, std::memory_order_relaxed);
+  }
+  auto Live(uint port) const -> byte_t { return m_live[port].load(std::memory_order_relaxed); }
+
+  void Lock(std::array<byte_t, 2> const& input);
+  void Unlock();
+
+  auto Read(uint port) -> byte_t;
+  void Write(byte_t value);
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
+
+private:
+  std::array<std::atomic<byte_t>, 2> m_live = {};
+  std::array<byte_t, 2> m_shift = {};
+  std::array<byte_t, 2> m_locked_input = {};
+  bool m_strobe = false;
+  bool m_locked = false;
+
+  void Latch();
+};
+
+}  // namespace nes
@@ -1,5 +1,11 @@
 #include "nes/cpu.hpp"
 
+#include <stdexcept>
+
+#if !defined(RENES_CPU_FLAT_BUS)
+#include "nes/bus.hpp"
+#endif
+
 namespace nes {
 
 // ----------------------------------------------
@@ -8,15 +14,21 @@ namespace nes {
 
 Cpu::Cpu() { Reset(); }
 
-void Cpu::AttachBus(Bus* bus) { m_bus = AssumeNotNull(bus); }
+void Cpu::AttachBus(BusType* bus) { m_bus = AssumeNotNull(bus); }
 
 void Cpu::Reset() {
+  m_opcode = 0;
   m_opinfo = optable[0];  // BRK instruction
   m_cycles = m_opinfo.cycles;
   m_op = &Cpu::HandleReset;
 }
 
 void Cpu::Step() {
+  if (m_stall > 0) {
+    --m_stall;
+    return;
+  }
+
   // TODO: Handle interrupts
   switch (m_cycles) {
   case 1: Execute(); break;
@@ -33,17 +45,68 @@ void Cpu::SetProgramCounter(addr_t pc) {
 }
 
 auto Cpu::GetRegisters() const -> Registers const& { return m_reg; }
+auto Cpu::GetInstructionCount() const -> std::uint64_t { return m_instructions; }
+void Cpu::SaveState(State& state) const {
+  auto kind = OpKind::Instruction;
+  if (m_op == &Cpu::HandleNmi) kind = OpKind::Nmi;
+  if (m_op == &Cpu::HandleIrq) kind = OpKind::Irq;
+  if (m_op == &Cpu::HandleReset) kind = OpKind::Reset;
+
+  state.reg = m_reg;
+  state.op_address = m_opinfo.address;
+  state.addr = m_addr;
+  state.opcode = m_opcode;
+  state.op_kind = static_cast<byte_t>(kind);
+  state.data = m_data;
+  state.cycles = m_cycles;
+  state.executed = m_executed;
+  state.nmi = m_nmi;
+  state.irq = m_irq;
+  state.stall = m_stall;
+  state.instructions = m_instructions;
+}
+
+void Cpu::LoadState(State const& state) {
+  m_reg = state.reg;
+  m_opcode = state.opcode;
+  m_opinfo = optable[m_opcode];
+  m_opinfo.address = state.op_address;
+  m_addr = state.addr;
+  m_data = state.data;
+  m_cycles = state.cycles;
+  m_executed = state.executed;
+  m_nmi = state.nmi;
+  m_irq = state.irq;
+  m_stall = state.stall;
+  m_instructions = state.instructions;
+
+  switch (static_cast<OpKind>(state.op_kind)) {
+  case OpKind::Instruction: SetInstruction(); break;
+  case OpKind::Nmi: m_op = &Cpu::HandleNmi; break;
+  case OpKind::Irq: m_op = &Cpu::HandleIrq; break;
+  case OpKind::Reset: m_op = &Cpu::HandleReset; break;
+  default: throw std::runtime_error("Invalid CPU state");
+  }
+}
+
 auto Cpu::GetOpInfo() -> OpInfo { return m_opinfo; }
 auto Cpu::GetOpAssembly() -> string {
+  auto lo = Read(static_cast<addr_t>(m_opinfo.address + 1));
+  auto hi = Read(static_cast<addr_t>(m_opinfo.address + 2));
+  return Disassemble(m_opinfo, lo, hi);
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+auto Cpu::Disassemble(OpInfo const& op, byte_t lo, byte_t hi) -> string {
   auto assembly = string{};
   assembly.reserve(16);
-  assembly += Hexify(m_opinfo.address) + ' ' + m_opinfo.name + ' ';
+  assembly += Hexify(op.address) + ' ' + op.name + ' ';
 
-  auto lo = Read(static_cast<addr_t>(m_opinfo.address + 1));
-  auto hi = Read(static_cast<addr_t>(m_opinfo.address + 2));
   auto addr = JoinBytes(lo, hi);
-
-  switch (m_opinfo.mode) {
+  switch (op.mode) {
   case OpMode::Absolute: assembly += Hexify(addr); break;
   case OpMode::AbsoluteX: assembly += Hexify(addr) + ",X"; break;
   case OpMode::AbsoluteY: assembly += Hexify(addr) + ",Y"; break;
@@ -62,40 +125,43 @@ auto Cpu::GetOpAssembly() -> string {
   return assembly;
 }
 
-// ----------------------------------------------
-// Private member function definitions
-// ----------------------------------------------
-
-auto Cpu::PrintStatus() -> string {
+// runs on the logging thread, from the bytes Decode captured
+auto Cpu::FormatStatus(OpInfo op, byte_t lo, byte_t hi, Registers reg) -> string {
   auto status = string{};
   status.reserve(70);
-  status += "[CPU] ... " + GetOpAssembly();
-  if (status.length() <= 27) { status += string(27 - status.length(), ' '); }
-  status += " | A: " + Hexify(m_reg.a);
-  status += " | X: " + Hexify(m_reg.x);
-  status += " | Y: " + Hexify(m_reg.y);
-  status += " | P: " + Hexify(m_reg.p);
-  status += " | S: " + Hexify(m_reg.s);
+  status += "... " + Disassemble(op, lo, hi);
+  if (status.length() <= 21) { status += string(21 - status.length(), ' '); }
+  status += " | A: " + Hexify(reg.a);
+  status += " | X: " + Hexify(reg.x);
+  status += " | Y: " + Hexify(reg.y);
+  status += " | P: " + Hexify(reg.p);
+  status += " | S: " + Hexify(reg.s);
   return status;
 }
 
 void Cpu::Decode() {
   if (m_nmi) {
+    m_opcode = 0;
     m_opinfo = optable[0];  // BRK
     m_op = &Cpu::HandleNmi;
-  } else if (m_irq && !IrqDisabled()) {
+  } else if (m_irq != 0 && !IrqDisabled()) {
+    m_opcode = 0;
     m_opinfo = optable[0];  // BRK
     m_op = &Cpu::HandleIrq;
   } else {
-    m_opinfo = optable[Fetch()];
+    m_opcode = Fetch();
+    m_opinfo = optable[m_opcode];
     m_opinfo.address = m_reg.pc - 1;
     PrepareInstruction();
   }
 
   m_cycles = m_opinfo.cycles;
   m_executed = false;
+  ++m_instructions;
 
-  LOG_TRACE(PrintStatus());
+  LOG_DEFERRED(Trace, Cpu, &Cpu::FormatStatus, m_opinfo,
+               Read(static_cast<addr_t>(m_opinfo.address + 1)),
+               Read(static_cast<addr_t>(m_opinfo.address + 2)), m_reg);
 }
 
 void Cpu::Execute() {
@@ -103,19 +169,22 @@ void Cpu::Execute() {
   m_executed = true;
 }
 
-void Cpu::RequestIrq() { m_irq = true; }
+void Cpu::SetIrq(IrqSource source, bool active) {
+  auto bit = static_cast<byte_t>(source);
+  m_irq = active ? (m_irq | bit) : (m_irq & ~bit);
+}
+
 void Cpu::RequestNmi() { m_nmi = true; }
+void Cpu::Stall(byte_t cycles) { m_stall += cycles; }
 
 void Cpu::HandleIrq() {
-  LOG_TRACE("[CPU] ... Handling IRQ");
-  IrqDisabled(true);
+  LOG_TRACE_IN(Cpu, "... Handling IRQ");
+  // the line stays asserted until the source is acknowledged, which the handler has to do
   Interrupt(locations::irq_vector, false);
-  m_irq = false;
 }
 
 void Cpu::HandleNmi() {
-  LOG_TRACE("[CPU] ... Handling NMI");
-  IrqDisabled(true);
+  LOG_TRACE_IN(Cpu, "... Handling NMI");
   Interrupt(locations::nmi_vector, false);
   m_nmi = false;
 }
@@ -188,8 +257,10 @@ void Cpu::Interrupt(addr_t addr, bool break_flag) {
   Push(lo);
   Push(m_reg.p);
   BreakSet(true);
+  // only after pushing the status, so that RTI unmasks interrupts again
+  IrqDisabled(true);
   m_reg.pc = ReadAddress(addr);
-  LOG_TRACE("[CPU] ... Program counter set to " + Hexify(m_reg.pc));
+  LOG_TRACE_IN(Cpu, "... Program counter set to " + Hexify(m_reg.pc));
 }
 
 void Cpu::Absolute(addr_t offset = 0) {
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "nes/bus.hpp"
+#if defined(RENES_CPU_FLAT_BUS)
+#include "nes/flat_bus.hpp"
+#endif
 #include "nes/common.hpp"
 #include "nes/locations.hpp"
 #include "nes/opinfo.hpp"
@@ -8,10 +10,20 @@
 
 namespace nes {
 
+class Bus;
+
 class Cpu {
   friend class Bus;
 
 public:
+  // renes-cputest compiles the CPU a second time with RENES_CPU_FLAT_BUS defined, putting it on
+  // plain RAM so test vectors can drive it without a console around it
+#if defined(RENES_CPU_FLAT_BUS)
+  using BusType = FlatBus;
+#else
+  using BusType = Bus;
+#endif
+
   struct Registers {
     addr_t pc;  // program counter
     byte_t a;   // accumulator
@@ -21,43 +33,75 @@ public:
     byte_t p;   // processor status
   };
 
+  // The IRQ input is a level-triggered, wired-OR line: each source holds its own bit until the game
+  // acknowledges that source, and an IRQ is taken whenever any bit is set and I is clear.
+  enum class IrqSource : byte_t { Mapper = 1 << 0, FrameCounter = 1 << 1, Dmc = 1 << 2 };
+
+  // everything needed to resume mid-instruction; see SaveState
+  struct State {
+    Registers reg;
+    addr_t op_address;
+    addr_t addr;
+    byte_t opcode;
+    byte_t op_kind;
+    byte_t data;
+    byte_t cycles;
+    bool executed;
+    bool nmi;
+    byte_t irq;  // one bit per IrqSource
+    byte_t stall;
+    std::uint64_t instructions;
+  };
+
   Cpu();
 
-  void AttachBus(Bus* bus);
+  void AttachBus(BusType* bus);
   void Reset();
   void Step();
 
   void SetProgramCounter(addr_t pc);
 
   auto GetRegisters() const -> Registers const&;
+  auto GetInstructionCount() const -> std::uint64_t;
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
   auto GetOpInfo() -> OpInfo;
   auto GetOpAssembly() -> string;
 
 private:
   using Op = void (Cpu::*)();
 
+  // how m_op was chosen, so that it can be rebuilt when loading a state
+  enum class OpKind : byte_t { Instruction, Nmi, Irq, Reset };
+
   Registers m_reg = {};
-  Bus* m_bus = nullptr;
+  BusType* m_bus = nullptr;
   OpInfo m_opinfo = {};
   Op m_op = nullptr;
+  byte_t m_opcode = 0;
   addr_t m_addr = 0;
   byte_t m_data = 0;
   byte_t m_cycles = 0;
+  std::uint64_t m_instructions = 0;
   bool m_executed = false;
   bool m_nmi = false;
-  bool m_irq = false;
+  byte_t m_irq = 0;  // one bit per IrqSource
+  byte_t m_stall = 0;  // cycles the CPU is held off the bus by DMA before it continues
 
   // --------------------------------------------
   // Basic read/write operations
   // --------------------------------------------
 
-  auto PrintStatus() -> string;
+  static auto Disassemble(OpInfo const& op, byte_t lo, byte_t hi) -> string;
+  static auto FormatStatus(OpInfo op, byte_t lo, byte_t hi, Registers reg) -> string;
 
   void Decode();
   void Execute();
 
-  void RequestIrq();
+  void SetIrq(IrqSource source, bool active);
   void RequestNmi();
+  void Stall(byte_t cycles);
   void HandleIrq();
   void HandleNmi();
   void HandleReset();
@@ -6,7 +6,7 @@ void Display::DrawPixel(size_t x, size_t y, Pixel pixel) {
   if (auto index = GetIndex(x, y); index < m_pixels.size()) { m_pixels[index] = pixel; }
 }
 
-auto Display::ReadPixel(size_t x, size_t y) -> Pixel {
+auto Display::ReadPixel(size_t x, size_t y) const -> Pixel {
   if (auto index = GetIndex(x, y); index < m_pixels.size()) {
     return m_pixels[GetIndex(x, y)];
   } else {
@@ -15,6 +15,9 @@ auto Display::ReadPixel(size_t x, size_t y) -> Pixel {
 }
 
 auto Display::GetRawPixelBuffer() -> byte_t* { return reinterpret_cast<byte_t*>(m_pixels.data()); }
+auto Display::GetRawPixelBuffer() const -> byte_t const* {
+  return reinterpret_cast<byte_t const*>(m_pixels.data());
+}
 
 auto Display::GetIndex(size_t x, size_t y) const -> size_t {
   if (x < m_width && y < m_height) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cassert>
 
 #include "nes/common.hpp"
@@ -35,8 +36,9 @@ public:
   static constexpr auto Height() { return m_height; }
 
   void DrawPixel(size_t x, size_t y, Pixel pixel);
-  auto ReadPixel(size_t x, size_t y) -> Pixel;
+  auto ReadPixel(size_t x, size_t y) const -> Pixel;
   auto GetRawPixelBuffer() -> byte_t*;
+  auto GetRawPixelBuffer() const -> byte_t const*;
 
 private:
   static constexpr size_t m_width = 256;
@@ -0,0 +1,77 @@
+#include "nes/filter_worker.hpp"
+
+#include <algorithm>
+
+namespace nes {
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+FilterWorker::FilterWorker(std::function<void()> on_frame)
+  : m_on_frame{std::move(on_frame)},
+    m_input(Display::Width() * Display::Height() * 3),
+    m_output(Display::Width() * Display::Height() * 3),
+    m_thread{&FilterWorker::Loop, this} {}
+
+FilterWorker::~FilterWorker() {
+  {
+    auto lock = std::lock_guard{m_mutex};
+    m_stopping = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+void FilterWorker::SetFilter(VideoFilter filter) {
+  m_filter.store(filter, std::memory_order_relaxed);
+}
+
+auto FilterWorker::GetFilter() const -> VideoFilter {
+  return m_filter.load(std::memory_order_relaxed);
+}
+
+void FilterWorker::Submit(Display const& display) {
+  TRACE_ZONE("FilterWorker::Submit");
+  auto const* pixels = display.GetRawPixelBuffer();
+  {
+    auto lock = std::lock_guard{m_mutex};
+    std::copy(pixels, pixels + m_input.size(), m_input.begin());
+    m_submitted = true;
+  }
+  m_cv.notify_one();
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void FilterWorker::Loop() {
+  TRACE_THREAD("filter");
+  m_working.resize(m_input.size());
+  while (true) {
+    {
+      auto lock = std::unique_lock{m_mutex};
+      m_cv.wait(lock, [this] { return m_submitted || m_stopping; });
+      if (m_stopping) return;
+      m_input.swap(m_working);
+      m_submitted = false;
+    }
+
+    auto filter = GetFilter();
+    {
+      TRACE_ZONE("FilterWorker::Apply");
+      m_frame_filter.Apply(filter, m_working.data(), m_filtered);
+    }
+
+    {
+      auto lock = std::lock_guard{m_output_mutex};
+      m_output.swap(m_filtered);
+      m_output_width = Display::Width() * GetFilterScale(filter);
+      m_output_height = Display::Height() * GetFilterScale(filter);
+    }
+    m_on_frame();
+  }
+}
+
+}  // namespace nes
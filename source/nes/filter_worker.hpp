@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/display.hpp"
+#include "nes/video_filter.hpp"
+
+namespace nes {
+
+// Runs the video filter on a thread of its own, so neither the emulation thread nor the GUI thread
+// pays for it. Only the latest frame matters: one that arrives while the previous is still being
+// filtered replaces whatever was waiting, and nothing ever blocks for longer than a frame copy.
+class FilterWorker {
+public:
+  // `on_frame` runs on the worker thread each time a filtered frame becomes readable
+  explicit FilterWorker(std::function<void()> on_frame);
+  FilterWorker(FilterWorker const&) = delete;
+  FilterWorker& operator=(FilterWorker const&) = delete;
+  ~FilterWorker();
+
+  // takes effect from the next frame submitted
+  void SetFilter(VideoFilter filter);
+  auto GetFilter() const -> VideoFilter;
+
+  // copies the frame for filtering; safe to call from any thread
+  void Submit(Display const& display);
+
+  // calls `read(pixels, width, height)` with the latest filtered frame (packed RGB), which stays
+  // put until `read` returns
+  template <class F>
+  void Read(F&& read) const {
+    auto lock = std::lock_guard{m_output_mutex};
+    read(m_output.data(), m_output_width, m_output_height);
+  }
+
+private:
+  std::function<void()> m_on_frame;
+  std::atomic<VideoFilter> m_filter = VideoFilter::None;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<byte_t> m_input;
+  bool m_submitted = false;
+  bool m_stopping = false;
+
+  // only touched by the worker thread
+  FrameFilter m_frame_filter;
+  std::vector<byte_t> m_working;
+  std::vector<byte_t> m_filtered;
+
+  mutable std::mutex m_output_mutex;
+  std::vector<byte_t> m_output;
+  size_t m_output_width = Display::Width();
+  size_t m_output_height = Display::Height();
+
+  std::thread m_thread;  // last, so it starts after everything it uses
+
+  void Loop();
+};
+
+}  // namespace nes
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// 64 KiB of plain RAM behind every address, for running the CPU on its own against single-step
+// test vectors. Writes are remembered so that a test can check nothing else was touched and undo
+// what a case left behind without clearing the whole array.
+struct FlatBus {
+  std::array<byte_t, 0x10000> memory = {};
+  std::vector<addr_t> writes = {};
+
+  auto Read(addr_t addr) -> byte_t { return memory[addr]; }
+  void Write(addr_t addr, byte_t value) {
+    memory[addr] = value;
+    writes.push_back(addr);
+  }
+};
+
+}  // namespace nes
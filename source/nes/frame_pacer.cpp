@@ -0,0 +1,90 @@
+#include "nes/frame_pacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "nes/utility.hpp"
+
+namespace nes {
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+FramePacer::FramePacer() { SetFrameRate(ntsc_frame_rate); }
+
+void FramePacer::SetFrameRate(double frames_per_second) {
+  auto period = std::chrono::duration<double>{1.0 / frames_per_second};
+  m_period = std::chrono::duration_cast<Clock::duration>(period);
+  Reset();
+}
+
+void FramePacer::Reset() {
+  m_deadline = Clock::now() + m_period;
+
+  std::lock_guard lock{m_mutex};
+  m_next_sample = 0;
+  m_samples = 0;
+}
+
+void FramePacer::Wait() {
+  using namespace std::chrono;
+  TRACE_ZONE("FramePacer::Wait");
+
+  auto now = Clock::now();
+  if (now + m_spin_margin < m_deadline) {
+    auto wake = m_deadline - m_spin_margin;
+    std::this_thread::sleep_until(wake);
+
+    // track how late the OS wakes us up, so the spin margin covers the scheduler's usual slack
+    // without spinning any longer than necessary
+    auto oversleep = Clock::now() - wake;
+    auto target = std::clamp<Clock::duration>(2 * oversleep, microseconds{200}, milliseconds{4});
+    m_spin_margin += (target - m_spin_margin) / 8;
+  }
+
+  while ((now = Clock::now()) < m_deadline) {}
+
+  Record(now - m_deadline);
+
+  m_deadline += m_period;
+  if (now - m_deadline > max_frames_behind * m_period) {
+    LOG_DEBUG("[PACER] Fell too far behind schedule; resynchronizing");
+    m_deadline = now + m_period;
+  }
+}
+
+auto FramePacer::GetJitter() const -> Jitter {
+  std::array<float, history_size> samples;
+  size_t count = 0;
+  {
+    std::lock_guard lock{m_mutex};
+    count = m_samples;
+    std::copy_n(m_lateness_us.begin(), count, samples.begin());
+  }
+
+  auto jitter = Jitter{};
+  jitter.samples = count;
+  if (count == 0) return jitter;
+
+  jitter.p50_us = Percentile(samples.begin(), count, 0.50);
+  jitter.p90_us = Percentile(samples.begin(), count, 0.90);
+  jitter.p99_us = Percentile(samples.begin(), count, 0.99);
+  jitter.max_us = *std::max_element(samples.begin(), samples.begin() + count);
+  return jitter;
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void FramePacer::Record(Clock::duration lateness) {
+  auto us = std::chrono::duration<float, std::micro>{lateness}.count();
+
+  std::lock_guard lock{m_mutex};
+  m_lateness_us[m_next_sample] = us;
+  m_next_sample = (m_next_sample + 1) % history_size;
+  m_samples = std::min(m_samples + 1, history_size);
+}
+
+}  // namespace nes
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Holds the emulation thread to a fixed frame rate. Each wait sleeps coarsely until shortly before
+// the deadline and spins for the remainder; deadlines advance on an absolute schedule so that
+// rounding in individual waits never accumulates into drift.
+class FramePacer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr double ntsc_frame_rate = 60.0988;
+
+  struct Jitter {
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+    size_t samples = 0;
+  };
+
+  FramePacer();
+
+  void SetFrameRate(double frames_per_second);
+  void Reset();
+  void Wait();
+
+  auto GetJitter() const -> Jitter;
+
+private:
+  // give up on catching up once we're this many frames behind (e.g. after a debugger break)
+  static constexpr int max_frames_behind = 4;
+  static constexpr size_t history_size = 1024;
+
+  Clock::duration m_period = {};
+  Clock::time_point m_deadline = {};
+  Clock::duration m_spin_margin = std::chrono::milliseconds{2};
+
+  mutable std::mutex m_mutex;
+  std::array<float, history_size> m_lateness_us = {};
+  size_t m_next_sample = 0;
+  size_t m_samples = 0;
+
+  void Record(Clock::duration lateness);
+};
+
+}  // namespace nes
@@ -0,0 +1,148 @@
+#include "nes/hash.hpp"
+
+#include <array>
+#include <cstring>
+
+#include "nes/simd.hpp"
+
+namespace nes {
+
+namespace {
+
+constexpr size_t lanes = 8;
+constexpr size_t stripe_size = lanes * sizeof(std::uint64_t);
+constexpr size_t stripes_per_block = 16;
+constexpr size_t block_size = stripes_per_block * stripe_size;
+
+constexpr std::uint64_t prime32_1 = 0x9E37'79B1;
+constexpr std::uint64_t prime32_2 = 0x85EB'CA77;
+constexpr std::uint64_t prime32_3 = 0xC2B2'AE3D;
+constexpr std::uint64_t prime64_1 = 0x9E37'79B1'85EB'CA87;
+constexpr std::uint64_t prime64_2 = 0xC2B2'AE3D'27D4'EB4F;
+constexpr std::uint64_t prime64_3 = 0x1656'67B1'9E37'79F9;
+constexpr std::uint64_t prime64_4 = 0x85EB'CA77'C2B2'AE63;
+constexpr std::uint64_t prime64_5 = 0x27D4'EB2F'1656'67C5;
+
+// Stripe s of a block is keyed with words [s, s + 8) and the scramble with the last eight; the
+// words themselves are just splitmix64 output
+constexpr auto secret = [] {
+  auto words = std::array<std::uint64_t, stripes_per_block + lanes>{};
+  auto state = prime64_1;
+  for (auto& word : words) {
+    state += 0x9E37'79B9'7F4A'7C15;
+    auto z = state;
+    z = (z ^ (z >> 30)) * 0xBF58'476D'1CE4'E5B9;
+    z = (z ^ (z >> 27)) * 0x94D0'49BB'1331'11EB;
+    word = z ^ (z >> 31);
+  }
+  return words;
+}();
+
+#if !defined(RENES_SIMD_SSE2)
+auto Load64(byte_t const* p) -> std::uint64_t {
+  auto value = std::uint64_t{0};
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+#endif
+
+// Runs `count` stripes through the lanes, the first of them being stripe `first` of its block.
+// Each lane adds its neighbour's data as it is and its own data's two halves multiplied together
+// after keying; the plain add keeps every input bit in the sum, the product spreads them.
+void Accumulate(std::uint64_t* acc, byte_t const* data, size_t first, size_t count) {
+#if defined(RENES_SIMD_SSE2)
+  auto Load = [](void const* p) { return _mm_loadu_si128(static_cast<__m128i const*>(p)); };
+  __m128i sums[lanes / 2];
+  for (auto j = size_t{0}; j < lanes / 2; ++j) sums[j] = Load(acc + 2 * j);
+
+  for (auto s = size_t{0}; s < count; ++s) {
+    auto const* stripe = data + s * stripe_size;
+    auto const* key = secret.data() + first + s;
+    for (auto j = size_t{0}; j < lanes / 2; ++j) {
+      auto value = Load(stripe + 16 * j);
+      auto keyed = _mm_xor_si128(value, Load(key + 2 * j));
+      // low halves times high halves, and the two lanes' data swapped over
+      auto product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+      auto swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+      sums[j] = _mm_add_epi64(sums[j], _mm_add_epi64(product, swapped));
+    }
+  }
+
+  for (auto j = size_t{0}; j < lanes / 2; ++j) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2 * j), sums[j]);
+  }
+#else
+  for (auto s = size_t{0}; s < count; ++s) {
+    auto const* stripe = data + s * stripe_size;
+    auto const* key = secret.data() + first + s;
+    for (auto i = size_t{0}; i < lanes; ++i) {
+      auto value = Load64(stripe + 8 * i);
+      auto keyed = value ^ key[i];
+      acc[i ^ 1] += value;
+      acc[i] += (keyed & 0xFFFF'FFFF) * (keyed >> 32);
+    }
+  }
+#endif
+}
+
+// once per block, so that the products don't only ever pile up in the lanes' low bits
+void Scramble(std::uint64_t* acc) {
+  auto const* key = secret.data() + stripes_per_block;
+  for (auto i = size_t{0}; i < lanes; ++i) {
+    acc[i] ^= acc[i] >> 47;
+    acc[i] ^= key[i];
+    acc[i] *= prime32_1;
+  }
+}
+
+// the full 128-bit product, its halves xored together
+auto Multiply128Fold(std::uint64_t a, std::uint64_t b) -> std::uint64_t {
+  auto lo_lo = (a & 0xFFFF'FFFF) * (b & 0xFFFF'FFFF);
+  auto hi_lo = (a >> 32) * (b & 0xFFFF'FFFF);
+  auto lo_hi = (a & 0xFFFF'FFFF) * (b >> 32);
+  auto hi_hi = (a >> 32) * (b >> 32);
+  auto cross = (lo_lo >> 32) + (hi_lo & 0xFFFF'FFFF) + lo_hi;
+  auto upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  auto lower = (cross << 32) | (lo_lo & 0xFFFF'FFFF);
+  return lower ^ upper;
+}
+
+auto Avalanche(std::uint64_t h) -> std::uint64_t {
+  h ^= h >> 37;
+  h *= 0x1656'6791'9E37'79F9;
+  return h ^ (h >> 32);
+}
+
+}  // namespace
+
+auto Hash64(void const* data, size_t size) -> std::uint64_t {
+  auto const* bytes = static_cast<byte_t const*>(data);
+  auto const* end = bytes + size;
+  std::uint64_t acc[lanes] = {prime32_3, prime64_1, prime64_2, prime64_3,
+                              prime64_4, prime32_2, prime64_5, prime32_1};
+
+  for (; static_cast<size_t>(end - bytes) >= block_size; bytes += block_size) {
+    Accumulate(acc, bytes, 0, stripes_per_block);
+    Scramble(acc);
+  }
+
+  auto stripes = static_cast<size_t>(end - bytes) / stripe_size;
+  Accumulate(acc, bytes, 0, stripes);
+  bytes += stripes * stripe_size;
+
+  // the tail is padded out to a whole stripe with zeros, which the length folded in below tells
+  // apart from zeros that were really there
+  if (bytes != end) {
+    byte_t last[stripe_size] = {};
+    std::memcpy(last, bytes, static_cast<size_t>(end - bytes));
+    Accumulate(acc, last, stripes, 1);
+  }
+
+  auto hash = size * prime64_1;
+  for (auto i = size_t{0}; i < lanes; i += 2) {
+    hash += Multiply128Fold(acc[i] ^ secret[i + 4], acc[i + 1] ^ secret[i + 5]);
+  }
+  return Avalanche(hash);
+}
+
+}  // namespace nes
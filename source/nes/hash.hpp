@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// A 64-bit non-cryptographic hash built the way XXH3 hashes long inputs: eight 64-bit lanes each
+// take a 32x32-bit product of the data mixed with a sliding key, every 1 KiB block is scrambled,
+// and the lanes are folded together at the end. Runs two lanes per SSE2 instruction where the
+// target has it, with the same result everywhere. It is not xxHash's own output.
+//
+// Meant for telling frames and emulator states apart from one run to the next: quick enough to
+// run over every frame, and not stable across releases if the algorithm ever needs to change.
+auto Hash64(void const* data, size_t size) -> std::uint64_t;
+
+}  // namespace nes
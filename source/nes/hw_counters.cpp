@@ -0,0 +1,142 @@
+#include "nes/hw_counters.hpp"
+
+#include <utility>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+
+  #include <cerrno>
+  #include <cstring>
+  #define RENES_HAS_PERF_EVENTS
+#endif
+
+namespace nes {
+
+#if defined(RENES_HAS_PERF_EVENTS)
+namespace {
+
+// in HwCounters::Event order
+constexpr std::array<std::uint64_t, 4> event_configs = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+constexpr std::array<char const*, 4> event_names = {
+    "cycles",
+    "instructions",
+    "cache misses",
+    "branch misses",
+};
+
+// counts the calling thread on whichever CPU it runs; the group leader starts out disabled so
+// that Open() can start every counter in the group at once
+auto OpenEvent(std::uint64_t config, int leader) -> int {
+  auto attr = perf_event_attr{};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = leader < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+}
+
+}  // namespace
+#endif
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+HwCounters::~HwCounters() { Close(); }
+
+auto HwCounters::Open() -> bool {
+  Close();
+
+#if defined(RENES_HAS_PERF_EVENTS)
+  auto error = 0;
+  for (auto i = size_t{0}; i < event_count; ++i) {
+    auto fd = OpenEvent(event_configs[i], m_leader);
+    if (fd < 0) {
+      if (error == 0) error = errno;
+      LOG_DEBUG("... No host counter for " + string{event_names[i]} + ": " + std::strerror(errno));
+      continue;
+    }
+
+    if (m_leader < 0) m_leader = fd;
+    m_fds[i] = fd;
+    m_slots[i] = static_cast<int>(m_opened++);
+  }
+
+  if (m_leader < 0) {
+    auto hint = "";
+    if (error == EACCES || error == EPERM) hint = "; see /proc/sys/kernel/perf_event_paranoid";
+    if (error == ENOENT || error == EOPNOTSUPP) hint = "; the host CPU (or VM) exposes none";
+    LOG_INFO("Hardware performance counters are unavailable (" + string{std::strerror(error)} +
+             ')' + hint);
+    return false;
+  }
+
+  ::ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ::ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+#else
+  LOG_INFO("Hardware performance counters are only supported on Linux");
+  return false;
+#endif
+}
+
+void HwCounters::Close() {
+#if defined(RENES_HAS_PERF_EVENTS)
+  // members first; closing the leader would otherwise tear the group down around them
+  for (auto i = event_count; i-- > 0;) {
+    if (m_fds[i] >= 0 && m_fds[i] != m_leader) ::close(m_fds[i]);
+  }
+  if (m_leader >= 0) ::close(m_leader);
+#endif
+
+  m_leader = -1;
+  m_fds.fill(-1);
+  m_opened = 0;
+}
+
+auto HwCounters::IsOpen() const -> bool { return m_leader >= 0; }
+
+auto HwCounters::Has(Event event) const -> bool {
+  return m_fds[static_cast<size_t>(event)] >= 0;
+}
+
+auto HwCounters::Read() const -> HwCounts {
+  auto counts = HwCounts{};
+
+#if defined(RENES_HAS_PERF_EVENTS)
+  if (m_leader < 0) return counts;
+
+  // the number of counters, how long the group was enabled and actually running, then one value
+  // per counter in the order they were opened
+  auto data = std::array<std::uint64_t, 3 + event_count>{};
+  if (::read(m_leader, data.data(), sizeof(data)) <= 0) return counts;
+
+  auto [enabled, running] = std::pair{data[1], data[2]};
+  auto scale = (running > 0 && running < enabled) ? double(enabled) / running : 1.0;
+  auto Value = [&](Event event) -> std::uint64_t {
+    auto i = static_cast<size_t>(event);
+    return m_fds[i] < 0 ? 0 : static_cast<std::uint64_t>(data[3 + m_slots[i]] * scale);
+  };
+
+  counts.cycles = Value(Event::Cycles);
+  counts.instructions = Value(Event::Instructions);
+  counts.cache_misses = Value(Event::CacheMisses);
+  counts.branch_misses = Value(Event::BranchMisses);
+#endif
+
+  return counts;
+}
+
+}  // namespace nes
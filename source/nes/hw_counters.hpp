@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// running totals of the host CPU's own counters; see HwCounters
+struct HwCounts {
+  std::uint64_t cycles = 0;
+  std::uint64_t instructions = 0;
+  std::uint64_t cache_misses = 0;  // last-level cache
+  std::uint64_t branch_misses = 0;
+
+  auto operator-(HwCounts const& rhs) const -> HwCounts {
+    return {cycles - rhs.cycles, instructions - rhs.instructions, cache_misses - rhs.cache_misses,
+            branch_misses - rhs.branch_misses};
+  }
+
+  auto Ipc() const -> double { return cycles > 0 ? double(instructions) / cycles : 0.0; }
+};
+
+// Hardware performance counters for one thread, read through Linux's perf_event_open. Only user
+// space is counted, which the default perf_event_paranoid setting allows. Where the kernel or the
+// platform doesn't, Open() says why in the log and Read() keeps returning zeros.
+class HwCounters {
+public:
+  enum class Event { Cycles, Instructions, CacheMisses, BranchMisses, Count };
+
+  HwCounters() = default;
+  HwCounters(HwCounters const&) = delete;
+  HwCounters& operator=(HwCounters const&) = delete;
+  ~HwCounters();
+
+  // starts counting the calling thread; true if at least one counter could be opened
+  auto Open() -> bool;
+  void Close();
+
+  auto IsOpen() const -> bool;
+  auto Has(Event event) const -> bool;
+
+  // totals since Open(), scaled up if the kernel had to share the hardware with other counters
+  auto Read() const -> HwCounts;
+
+private:
+  static constexpr auto event_count = static_cast<size_t>(Event::Count);
+
+  int m_leader = -1;
+  std::array<int, event_count> m_fds = {-1, -1, -1, -1};
+  std::array<int, event_count> m_slots = {};  // where each event sits in a group read
+  size_t m_opened = 0;
+};
+
+}  // namespace nes
@@ -43,6 +43,7 @@ constexpr addr_t dmc_start = 0x4012;
 constexpr addr_t dmc_len = 0x4013;
 
 constexpr addr_t sound_channel = 0x4015;
+constexpr addr_t frame_counter = 0x4017;  // write only; reads go to joystick2
 
 constexpr addr_t joystick1 = 0x4016;
 constexpr addr_t joystick2 = 0x4017;
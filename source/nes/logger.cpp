@@ -0,0 +1,243 @@
+#include "nes/logger.hpp"
+
+#if defined(RENES_ENABLE_LOGGING)
+
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nes {
+
+namespace {
+
+// Owns every thread's ring and the thread that empties them. It is created on first use and never
+// destroyed, so logging from other static destructors is harmless; its thread is stopped (and
+// everything written) at exit. A thread's ring outlives the thread and goes to the next thread
+// that starts logging, so only as many rings exist as threads were ever logging at once.
+class LogWriter {
+public:
+  static auto Get() -> LogWriter& {
+    static auto* writer = new LogWriter{};
+    return *writer;
+  }
+
+  auto Register() -> LogRing* {
+    std::lock_guard lock{m_mutex};
+    if (!m_free.empty()) {
+      auto* ring = m_free.back();
+      m_free.pop_back();
+      return ring;
+    }
+    m_rings.push_back(std::make_unique<LogRing>(m_rings.size()));
+    m_reported_drops.push_back(0);
+    return m_rings.back().get();
+  }
+
+  // called by a thread that is exiting; what it logged is written out before anyone reuses the ring
+  void Release(LogRing* ring) {
+    std::lock_guard lock{m_mutex};
+    Drain();
+    m_free.push_back(ring);
+  }
+
+  void SetFile(std::string const& file) {
+    std::lock_guard lock{m_mutex};
+    Drain();
+    if (file == "stdout") {
+      m_buf = std::cout.rdbuf();
+    } else if (file == "stderr") {
+      m_buf = std::cerr.rdbuf();
+    } else if (file == "stdlog") {
+      m_buf = std::clog.rdbuf();
+    } else {
+      m_file = std::ofstream{file};
+      m_buf = m_file.rdbuf();
+    }
+  }
+
+  void Flush() {
+    std::lock_guard lock{m_mutex};
+    Drain();
+  }
+
+private:
+  static constexpr auto period = std::chrono::milliseconds{2};
+
+  std::mutex m_mutex = {};  // guards everything below, and consuming from the rings
+  std::vector<std::unique_ptr<LogRing>> m_rings = {};
+  std::vector<std::uint64_t> m_reported_drops = {};
+  std::vector<LogRing*> m_free = {};
+  std::streambuf* m_buf = std::clog.rdbuf();
+  std::ofstream m_file = {};
+
+  std::mutex m_stop_mutex = {};
+  std::condition_variable m_stop_signal = {};
+  bool m_stop = false;
+  std::thread m_thread = {};
+
+  LogWriter() {
+    m_thread = std::thread{[this] { Run(); }};
+    std::atexit([] { Get().Stop(); });
+  }
+
+  void Run() {
+    auto lock = std::unique_lock{m_stop_mutex};
+    while (!m_stop_signal.wait_for(lock, period, [this] { return m_stop; })) {
+      lock.unlock();
+      Flush();
+      lock.lock();
+    }
+  }
+
+  void Stop() {
+    {
+      std::lock_guard lock{m_stop_mutex};
+      m_stop = true;
+    }
+    m_stop_signal.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    Flush();
+  }
+
+  // Writes whatever the rings hold right now. Only what was committed before the drain started is
+  // taken, so a thread that logs non-stop can't keep the writer here forever.
+  void Drain() {
+    auto pending = std::vector<std::size_t>(m_rings.size());
+    for (auto i = std::size_t{0}; i < m_rings.size(); ++i) pending[i] = m_rings[i]->Size();
+
+    auto out = std::ostringstream{};
+    while (true) {
+      // the oldest message at the front of any ring goes next
+      LogRing* next = nullptr;
+      std::size_t next_index = 0;
+      for (auto i = std::size_t{0}; i < m_rings.size(); ++i) {
+        if (pending[i] == 0) continue;
+        if (!next || m_rings[i]->Peek(0).timestamp < next->Peek(0).timestamp) {
+          next = m_rings[i].get();
+          next_index = i;
+        }
+      }
+      if (!next) break;
+
+      auto used = Format(out, *next);
+      next->Pop(used);
+      pending[next_index] -= used;
+    }
+
+    for (auto i = std::size_t{0}; i < m_rings.size(); ++i) {
+      auto dropped = m_rings[i]->Dropped();
+      if (dropped == m_reported_drops[i]) continue;
+      out << Prefix(LogLevel::Warn) << "[LOG] Dropped " << dropped - m_reported_drops[i]
+          << " message(s) from thread " << m_rings[i]->Id() << " - the log can't keep up\n";
+      m_reported_drops[i] = dropped;
+    }
+
+    auto text = out.str();
+    if (!text.empty()) {
+      m_buf->sputn(text.data(), static_cast<std::streamsize>(text.size()));
+      m_buf->pubsync();
+    }
+  }
+
+  // formats the message at the front of `ring`, returning how many records it took up
+  static auto Format(std::ostream& out, LogRing const& ring) -> std::size_t {
+    auto const& record = ring.Peek(0);
+    out << Prefix(record.level);
+    if (record.category != LogCategory::General) {
+      out << '[' << log_category_names[static_cast<std::size_t>(record.category)] << "] ";
+    }
+    if (record.format) {
+      record.format(out, record);
+      out << '\n';
+      return 1;
+    }
+
+    auto continuations = LogRecord::Continuations(record.size);
+    auto size = std::min<std::size_t>(record.size, LogRecord::payload_size);
+    out.write(record.payload.data(), static_cast<std::streamsize>(size));
+    auto remaining = record.size - size;
+    for (auto i = std::size_t{1}; i <= continuations; ++i) {
+      auto const* text = reinterpret_cast<char const*>(&ring.Peek(i));
+      size = std::min(remaining, sizeof(LogRecord));
+      out.write(text, static_cast<std::streamsize>(size));
+      remaining -= size;
+    }
+    if (record.truncated) out << "...";
+    out << '\n';
+    return 1 + continuations;
+  }
+
+  static auto Prefix(LogLevel level) -> char const* {
+    switch (level) {
+    case LogLevel::Error: return "[ERROR] : ";
+    case LogLevel::Warn: return "[WARN ] : ";
+    case LogLevel::Info: return "[INFO ] : ";
+    case LogLevel::Debug: return "[DEBUG] : ";
+    default: return "[TRACE] : ";
+    }
+  }
+};
+
+}  // namespace
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+void Log::SetFile(std::string const& file) { LogWriter::Get().SetFile(file); }
+
+void Log::Flush() { LogWriter::Get().Flush(); }
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+auto Log::Register() -> LogRing* {
+  // hands the ring back when the thread exits
+  struct Releaser {
+    ~Releaser() {
+      if (t_ring) LogWriter::Get().Release(t_ring);
+      t_ring = nullptr;
+    }
+  };
+  thread_local auto releaser = Releaser{};
+
+  return LogWriter::Get().Register();
+}
+
+void Log::WriteText(LogLevel level, LogCategory category, std::string_view text) {
+  constexpr auto max_size =
+      LogRecord::payload_size + LogRecord::max_continuations * sizeof(LogRecord);
+
+  auto size = std::min(text.size(), max_size);
+  auto count = 1 + LogRecord::Continuations(size);
+
+  auto& ring = Ring();
+  if (!ring.Claim(count)) return;
+
+  auto& record = ring.Slot(0);
+  record.timestamp = Now();
+  record.format = nullptr;
+  record.level = level;
+  record.category = category;
+  record.size = static_cast<std::uint16_t>(size);
+  record.truncated = size < text.size();
+
+  auto first = std::min(size, LogRecord::payload_size);
+  std::memcpy(record.payload.data(), text.data(), first);
+  for (auto i = std::size_t{1}, offset = first; i < count; ++i) {
+    auto n = std::min(size - offset, sizeof(LogRecord));
+    std::memcpy(reinterpret_cast<char*>(&ring.Slot(i)), text.data() + offset, n);
+    offset += n;
+  }
+  ring.Commit(count);
+}
+
+}  // namespace nes
+
+#endif
@@ -1,22 +1,113 @@
 #pragma once
 
-#include <fstream>
-#include <iostream>
-#include <mutex>
-
-#define LOG_LAZILY(expr) [&]() -> decltype(auto) { return expr; }
-#define LOG_FILE(file)   ::nes::Log::SetFile(file)
-#define LOG_LEVEL(level) ::nes::Log::SetLevel(::nes::LogLevel::level)
-#define LOG_TRACE(expr)  ::nes::Log::Trace(LOG_LAZILY(expr))
-#define LOG_DEBUG(expr)  ::nes::Log::Debug(LOG_LAZILY(expr))
-#define LOG_INFO(expr)   ::nes::Log::Info(LOG_LAZILY(expr))
-#define LOG_WARN(expr)   ::nes::Log::Warn(LOG_LAZILY(expr))
-#define LOG_ERROR(expr)  ::nes::Log::Error(LOG_LAZILY(expr))
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if !defined(RENES_ENABLE_LOGGING)
+#undef RENES_MAX_LOG_LEVEL
+#define RENES_MAX_LOG_LEVEL 0
+#elif !defined(RENES_MAX_LOG_LEVEL)
+#define RENES_MAX_LOG_LEVEL 5
+#endif
+
+#define LOG_FILE(file)         ::nes::Log::SetFile(file)
+#define LOG_LEVEL(level)       ::nes::Log::SetLevel(::nes::LogLevel::level)
+#define LOG_CATEGORIES(mask)   ::nes::Log::SetCategories(mask)
+#define LOG_FLUSH()            ::nes::Log::Flush()
+#define LOG_TRACE(expr)        LOG_AT(Trace, General, expr)
+#define LOG_DEBUG(expr)        LOG_AT(Debug, General, expr)
+#define LOG_INFO(expr)         LOG_AT(Info, General, expr)
+#define LOG_WARN(expr)         LOG_AT(Warn, General, expr)
+#define LOG_ERROR(expr)        LOG_AT(Error, General, expr)
+#define LOG_TRACE_IN(cat, expr) LOG_AT(Trace, cat, expr)
+#define LOG_DEBUG_IN(cat, expr) LOG_AT(Debug, cat, expr)
+#define LOG_INFO_IN(cat, expr)  LOG_AT(Info, cat, expr)
+#define LOG_WARN_IN(cat, expr)  LOG_AT(Warn, cat, expr)
+#define LOG_ERROR_IN(cat, expr) LOG_AT(Error, cat, expr)
+
+// Levels above RENES_MAX_LOG_LEVEL are compiled out entirely. Otherwise `expr` is only evaluated
+// if its level and category are enabled at runtime.
+#define LOG_AT(level, category, expr)                                                    \
+  do {                                                                                   \
+    if constexpr (::nes::LogLevel::level <= ::nes::max_log_level) {                      \
+      if (::nes::Log::Enabled(::nes::LogLevel::level, ::nes::LogCategory::category)) {   \
+        ::nes::Log::Write(::nes::LogLevel::level, ::nes::LogCategory::category, (expr)); \
+      }                                                                                  \
+    }                                                                                    \
+  } while (false)
+
+// Logs `format(args...)`, but only copies the arguments on the calling thread; `format` (a plain
+// function returning something printable) runs later on the logging thread. The arguments must be
+// trivially copyable.
+#define LOG_DEFERRED(level, category, format, ...)                                     \
+  do {                                                                                 \
+    if constexpr (::nes::LogLevel::level <= ::nes::max_log_level) {                    \
+      if (::nes::Log::Enabled(::nes::LogLevel::level, ::nes::LogCategory::category)) { \
+        ::nes::Log::Deferred(::nes::LogLevel::level, ::nes::LogCategory::category,     \
+                             format, __VA_ARGS__);                                     \
+      }                                                                                \
+    }                                                                                  \
+  } while (false)
 
 namespace nes {
 
 enum class LogLevel : int { None = 0, Error, Warn, Info, Debug, Trace, All, Default = Info };
 
+// the most verbose level that is compiled in at all
+inline constexpr auto max_log_level = static_cast<LogLevel>(RENES_MAX_LOG_LEVEL);
+
+// Subsystems whose debug and trace output can be switched on and off separately. Errors, warnings
+// and info messages are always logged; General messages are never filtered.
+enum class LogCategory : std::uint8_t { General = 0, Cpu, Ppu, Bus, Gui, Count };
+
+inline constexpr auto log_category_names =
+    std::array<char const*, 5>{"", "CPU", "PPU", "BUS", "GUI"};
+inline constexpr auto all_log_categories = (1u << static_cast<unsigned>(LogCategory::Count)) - 1;
+
+// Parses a comma separated list of category names, like "cpu,ppu" or "all", into a mask for
+// Log::SetCategories. Returns nothing if a name is not recognized.
+inline auto ParseLogCategories(std::string_view list) -> std::optional<unsigned> {
+  auto Equal = [](std::string_view a, std::string_view b) {
+    auto Lower = [](char c) { return std::tolower(static_cast<unsigned char>(c)); };
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [&](char x, char y) { return Lower(x) == Lower(y); });
+  };
+
+  auto mask = 1u;  // LogCategory::General
+  while (!list.empty()) {
+    auto comma = std::min(list.find(','), list.size());
+    auto name = list.substr(0, comma);
+    list.remove_prefix(std::min(comma + 1, list.size()));
+
+    if (Equal(name, "all")) {
+      mask = all_log_categories;
+      continue;
+    }
+    auto found = false;
+    for (auto i = 1u; i < log_category_names.size(); ++i) {
+      if (Equal(name, log_category_names[i])) {
+        mask |= 1u << i;
+        found = true;
+      }
+    }
+    if (!found) return std::nullopt;
+  }
+  return mask;
+}
+
 #if !defined(RENES_ENABLE_LOGGING)
 
 class Log {
@@ -25,87 +116,184 @@ public:
 
   static void SetLevel(LogLevel) {}
   static auto GetLevel() -> LogLevel { return LogLevel::None; }
+  static void SetCategories(unsigned) {}
+  static auto GetCategories() -> unsigned { return 0; }
+  static constexpr auto Enabled(LogLevel, LogCategory) -> bool { return false; }
+  static void Flush() {}
+
+  template <class Message>
+  static void Write(LogLevel, LogCategory, Message const&) {}
 
-  static void Trace(...) {}
-  static void Debug(...) {}
-  static void Info(...) {}
-  static void Warn(...) {}
-  static void Error(...) {}
+  template <class... Args>
+  static void Deferred(LogLevel, LogCategory, Args const&...) {}
 };
 
 #else
 
-class Log {
+// One message on its way from the thread that logged it to the logging thread. Deferred messages
+// keep their formatting function and its arguments in the payload; plain messages keep their text,
+// continuing into as many whole records after this one as it takes.
+struct LogRecord {
+  using Formatter = void (*)(std::ostream& out, LogRecord const& record);
+  static constexpr std::size_t payload_size = 104;
+  static constexpr std::size_t max_continuations = 7;
+
+  std::uint64_t timestamp;
+  Formatter format;  // null for plain text
+  LogLevel level;
+  std::uint16_t size;
+  LogCategory category;
+  bool truncated;
+  alignas(8) std::array<char, payload_size> payload;
+
+  // number of records after this one that hold the rest of a plain message
+  static constexpr auto Continuations(std::size_t size) -> std::size_t {
+    if (size <= payload_size) return 0;
+    return (size - payload_size + sizeof(LogRecord) - 1) / sizeof(LogRecord);
+  }
+};
+
+static_assert(sizeof(LogRecord) == 128);
+
+// Records from a single thread to the logging thread. When the ring is full, messages are dropped
+// (and counted) - logging never makes the emulator wait.
+class LogRing {
 public:
-  static void SetFile(std::string const& file) {
-    if (file == "stdout") {
-      m_buf = std::cout.rdbuf();
-    } else if (file == "stderr") {
-      m_buf = std::cerr.rdbuf();
-    } else if (file == "stdlog") {
-      m_buf = std::clog.rdbuf();
-    } else {
-      m_file = std::ofstream{file};
-      m_buf = m_file.rdbuf();
+  static constexpr std::size_t capacity = 4096;
+
+  explicit LogRing(std::size_t id) : m_id{id} {}
+
+  // producer only: Claim `count` records, fill them in through Slot, then Commit them
+  auto Claim(std::size_t count) -> bool {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail + count - m_head_cache > capacity) {
+      m_head_cache = m_head.load(std::memory_order_acquire);
+      if (tail + count - m_head_cache > capacity) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
     }
+    return true;
   }
 
-  static void SetLevel(LogLevel level) {
-    m_level = static_cast<int>(level);
-    if (m_level > 6) m_level = 6;  // LogLevel::All
-    if (m_level < 0) m_level = 0;  // LogLevel::None
+  auto Slot(std::size_t i) -> LogRecord& {
+    return m_records[(m_tail.load(std::memory_order_relaxed) + i) & (capacity - 1)];
   }
 
-  static auto GetLevel() -> LogLevel { return static_cast<LogLevel>(m_level); }
+  void Commit(std::size_t count) {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
 
-  template <class... Messages>
-  static void Trace(Messages&&... messages) {
-    if (m_level >= 5) WriteToStream("[TRACE] : ", std::forward<Messages>(messages)...);
+  // consumer only
+  auto Size() const -> std::size_t {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_relaxed);
   }
 
-  template <class... Messages>
-  static void Debug(Messages&&... messages) {
-    if (m_level >= 4) WriteToStream("[DEBUG] : ", std::forward<Messages>(messages)...);
+  auto Peek(std::size_t i) const -> LogRecord const& {
+    return m_records[(m_head.load(std::memory_order_relaxed) + i) & (capacity - 1)];
   }
 
-  template <class... Messages>
-  static void Info(Messages&&... messages) {
-    if (m_level >= 3) WriteToStream("[INFO ] : ", std::forward<Messages>(messages)...);
+  void Pop(std::size_t count) {
+    m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
   }
 
-  template <class... Messages>
-  static void Warn(Messages&&... messages) {
-    if (m_level >= 2) WriteToStream("[WARN ] : ", std::forward<Messages>(messages)...);
+  auto Id() const -> std::size_t { return m_id; }
+  auto Dropped() const -> std::uint64_t { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  alignas(64) std::atomic<std::size_t> m_tail = 0;
+  std::size_t m_head_cache = 0;
+  alignas(64) std::atomic<std::size_t> m_head = 0;
+  std::atomic<std::uint64_t> m_dropped = 0;
+  std::size_t m_id;
+  alignas(64) std::array<LogRecord, capacity> m_records;
+};
+
+// Messages are written by a background thread. The thread that logs only evaluates the message and
+// copies it into its own ring - no locks and no I/O. Messages from one thread are written in the
+// order they were logged; messages from different threads are merged by timestamp.
+class Log {
+public:
+  static void SetFile(std::string const& file);
+
+  static void SetLevel(LogLevel level) {
+    auto value = static_cast<int>(level);
+    if (value > 6) value = 6;  // LogLevel::All
+    if (value < 0) value = 0;  // LogLevel::None
+    m_level.store(value, std::memory_order_relaxed);
   }
 
-  template <class... Messages>
-  static void Error(Messages&&... messages) {
-    if (m_level >= 1) WriteToStream("[ERROR] : ", std::forward<Messages>(messages)...);
+  static auto GetLevel() -> LogLevel {
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
   }
 
-private:
-  inline static int m_level = static_cast<int>(LogLevel::Default);
-  inline static std::mutex m_mutex = {};
-  inline static std::streambuf* m_buf = std::clog.rdbuf();
-  inline static std::ofstream m_file = {};
-
-  template <class... Messages>
-  static void WriteToStream(Messages&&... messages) {
-    std::lock_guard lock{m_mutex};
-    std::ostream out(m_buf);
-    (out << ... << CallIfNeeded(std::forward<Messages>(messages))) << '\n';
-  }
-
-  template <class Expr>
-  static auto CallIfNeeded(Expr&& expr) -> decltype(auto) {
-    if constexpr (std::is_invocable_v<Expr>) {
-      return expr();
+  static void SetCategories(unsigned mask) { m_categories.store(mask, std::memory_order_relaxed); }
+  static auto GetCategories() -> unsigned { return m_categories.load(std::memory_order_relaxed); }
+
+  static auto Enabled(LogLevel level, LogCategory category) -> bool {
+    if (m_level.load(std::memory_order_relaxed) < static_cast<int>(level)) return false;
+    if (level <= LogLevel::Info) return true;
+    return m_categories.load(std::memory_order_relaxed) & (1u << static_cast<unsigned>(category));
+  }
+
+  // writes out everything logged so far
+  static void Flush();
+
+  template <class Message>
+  static void Write(LogLevel level, LogCategory category, Message const& message) {
+    if constexpr (std::is_convertible_v<Message const&, std::string_view>) {
+      WriteText(level, category, message);
     } else {
-      return expr;
+      auto out = std::ostringstream{};
+      out << message;
+      WriteText(level, category, out.str());
     }
   }
+
+  template <class Format, class... Args>
+  static void Deferred(LogLevel level, LogCategory category, Format format, Args const&... args) {
+    using Pack = std::pair<Format, std::tuple<Args...>>;
+    static_assert(std::is_pointer_v<Format>, "deferred formatters must be plain functions");
+    static_assert((std::is_trivially_copyable_v<Args> && ...), "arguments must be plain data");
+    static_assert(sizeof(Pack) <= LogRecord::payload_size, "too many arguments to defer");
+    static_assert(alignof(Pack) <= 8);
+
+    auto& ring = Ring();
+    if (!ring.Claim(1)) return;
+    auto& record = ring.Slot(0);
+    record.timestamp = Now();
+    record.format = &FormatDeferred<Pack>;
+    record.level = level;
+    record.category = category;
+    new (record.payload.data()) Pack{format, std::tuple<Args...>{args...}};
+    ring.Commit(1);
+  }
+
+private:
+  inline static std::atomic<int> m_level = static_cast<int>(LogLevel::Default);
+  inline static std::atomic<unsigned> m_categories = all_log_categories;
+  inline static thread_local LogRing* t_ring = nullptr;
+
+  static auto Register() -> LogRing*;
+  static void WriteText(LogLevel level, LogCategory category, std::string_view text);
+
+  static auto Ring() -> LogRing& {
+    if (!t_ring) t_ring = Register();
+    return *t_ring;
+  }
+
+  static auto Now() -> std::uint64_t {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  }
+
+  template <class Pack>
+  static void FormatDeferred(std::ostream& out, LogRecord const& record) {
+    auto const& pack = *std::launder(reinterpret_cast<Pack const*>(record.payload.data()));
+    out << std::apply(pack.first, pack.second);
+  }
 };
 
 #endif
 
-}  // namespace nes
\ No newline at end of file
+}  // namespace nes
@@ -5,6 +5,7 @@ namespace nes {
 auto CreateMapper(uint mapper) -> std::unique_ptr<Mapper> {
   switch (mapper) {
   case 0: return std::make_unique<Mapper_000>();
+  case 4: return std::make_unique<Mapper_004>();
   default: return nullptr;
   }
 }
@@ -7,6 +7,7 @@
 #include "nes/common.hpp"
 #include "nes/mappers/mapper.hpp"
 #include "nes/mappers/mapper_000.hpp"
+#include "nes/mappers/mapper_004.hpp"
 
 namespace nes {
 
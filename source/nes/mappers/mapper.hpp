@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include "nes/common.hpp"
@@ -8,12 +9,14 @@ namespace nes {
 
 class Mapper {
 public:
+  // raw bank and IRQ registers - each mapper lays out its own state within this block
+  using State = std::array<byte_t, 64>;
+
   virtual ~Mapper(){};
 
   auto Valid() -> bool { return (m_prg_rom.size() != 0) && (m_chr_rom.size() != 0); }
 
   void SetProgramRom(std::vector<byte_t>&& data) { m_prg_rom = std::move(data); }
-  void SetProgramRam(std::vector<byte_t>&& data) { m_prg_ram = std::move(data); }
   void SetCharacterRom(std::vector<byte_t>&& data) { m_chr_rom = std::move(data); }
   void SetCharacterRam(std::vector<byte_t>&& data) { m_chr_ram = std::move(data); }
 
@@ -22,10 +25,29 @@ public:
   virtual auto PpuRead(addr_t) -> byte_t = 0;
   virtual auto PpuWrite(addr_t, byte_t) -> byte_t = 0;
 
+  // where a CPU read from $8000-$FFFF lands in PRG-ROM; mappers that switch banks override this
+  virtual auto ProgramOffset(addr_t addr) const -> size_t {
+    return (addr - 0x8000) % m_prg_rom.size();
+  }
+
+  // mappers that switch nametable mirroring at runtime override these
+  virtual auto DynamicMirroring() const -> bool { return false; }
+  virtual auto VerticalMirroring() const -> bool { return false; }
+
+  // mappers with a scanline counter (e.g. MMC3) override these - the clocking functions return
+  // true when the mapper raises an IRQ, which stays pending until the game acknowledges it
+  virtual auto CountsScanlines() const -> bool { return false; }
+  virtual auto ClockScanline() -> bool { return false; }
+  virtual auto ObserveA12(bool, std::uint64_t) -> bool { return false; }
+  virtual auto IrqPending() const -> bool { return false; }
+
+  // mappers with internal registers override these
+  virtual void SaveState(State&) const {}
+  virtual void LoadState(State const&) {}
+
 protected:
   std::vector<byte_t> m_prg_rom;
   std::vector<byte_t> m_chr_rom;
-  std::vector<byte_t> m_prg_ram;
   std::vector<byte_t> m_chr_ram;
 };
 
@@ -0,0 +1,108 @@
+#include "nes/mappers/mapper_004.hpp"
+
+namespace nes {
+
+auto Mapper_004::CpuRead(addr_t addr) -> byte_t {
+  if (addr < 0x8000) return 0;
+  else {
+    return m_prg_rom[PrgOffset(addr)];
+  }
+}
+
+auto Mapper_004::CpuWrite(addr_t addr, byte_t value) -> byte_t {
+  if (addr < 0x8000) return 0;
+
+  auto even = (addr & 1) == 0;
+  switch (addr & 0xE000) {
+  case 0x8000:
+    if (even) {
+      m_reg.bank_select = value;
+    } else {
+      m_reg.bank_data[m_reg.bank_select & 0x07] = value;
+    }
+    break;
+  case 0xA000:
+    // PRG-RAM protection (odd addresses) is ignored, as MMC6 boards reuse the register
+    if (even) m_reg.horizontal = TestBit(value, 0);
+    break;
+  case 0xC000:
+    if (even) {
+      m_reg.irq_latch = value;
+    } else {
+      m_reg.irq_counter = 0;
+      m_reg.irq_reload = true;
+    }
+    break;
+  case 0xE000:
+    // disabling also acknowledges an IRQ already raised
+    m_reg.irq_enabled = !even;
+    if (even) m_reg.irq_pending = false;
+    break;
+  }
+
+  return 0;
+}
+
+auto Mapper_004::PpuRead(addr_t addr) -> byte_t { return m_chr_rom[ChrOffset(addr)]; }
+auto Mapper_004::PpuWrite(addr_t, byte_t) -> byte_t { return 0; }
+
+auto Mapper_004::ClockScanline() -> bool {
+  if (m_reg.irq_counter == 0 || m_reg.irq_reload) {
+    m_reg.irq_counter = m_reg.irq_latch;
+    m_reg.irq_reload = false;
+  } else {
+    --m_reg.irq_counter;
+  }
+
+  if (!m_reg.irq_enabled || m_reg.irq_counter != 0) return false;
+  m_reg.irq_pending = true;
+  return true;
+}
+
+auto Mapper_004::ObserveA12(bool high, std::uint64_t dot) -> bool {
+  auto clocked = false;
+  if (high && !m_reg.a12) {
+    if (dot - m_reg.a12_low_since >= a12_filter_dots) clocked = ClockScanline();
+  } else if (!high && m_reg.a12) {
+    m_reg.a12_low_since = dot;
+  }
+
+  m_reg.a12 = high;
+  return clocked;
+}
+
+void Mapper_004::SaveState(State& state) const {
+  static_assert(sizeof(Registers) <= sizeof(State));
+  std::memcpy(state.data(), &m_reg, sizeof(m_reg));
+}
+
+void Mapper_004::LoadState(State const& state) { std::memcpy(&m_reg, state.data(), sizeof(m_reg)); }
+
+auto Mapper_004::PrgOffset(addr_t addr) const -> size_t {
+  auto banks = m_prg_rom.size() / 0x2000;
+  auto swapped = TestBit(m_reg.bank_select, 6);
+
+  size_t bank = 0;
+  switch ((addr - 0x8000) / 0x2000) {
+  case 0: bank = swapped ? banks - 2 : m_reg.bank_data[6]; break;
+  case 1: bank = m_reg.bank_data[7]; break;
+  case 2: bank = swapped ? m_reg.bank_data[6] : banks - 2; break;
+  case 3: bank = banks - 1; break;
+  }
+
+  return (bank % banks) * 0x2000 + (addr % 0x2000);
+}
+
+auto Mapper_004::ChrOffset(addr_t addr) const -> size_t {
+  auto banks = m_chr_rom.size() / 0x0400;
+  auto slot = (addr / 0x0400) & 0x07;
+  if (TestBit(m_reg.bank_select, 7)) slot ^= 0x04;
+
+  // R0 and R1 select 2 KiB banks (the low bit is ignored), R2 - R5 select 1 KiB banks
+  size_t bank = (slot < 4) ? (m_reg.bank_data[slot / 2] & 0xFE) + (slot % 2)
+                           : m_reg.bank_data[slot - 2];
+
+  return (bank % banks) * 0x0400 + (addr % 0x0400);
+}
+
+}  // namespace nes
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+
+#include "nes/common.hpp"
+#include "nes/mappers/mapper.hpp"
+#include "nes/utility.hpp"
+
+namespace nes {
+
+// MMC3 - see https://wiki.nesdev.com/w/index.php/MMC3 for details
+class Mapper_004 : public Mapper {
+public:
+  ~Mapper_004() = default;
+
+  auto CpuRead(addr_t addr) -> byte_t;
+  auto CpuWrite(addr_t addr, byte_t value) -> byte_t;
+
+  auto PpuRead(addr_t addr) -> byte_t;
+  auto PpuWrite(addr_t, byte_t) -> byte_t;
+
+  auto ProgramOffset(addr_t addr) const -> size_t { return PrgOffset(addr); }
+
+  auto DynamicMirroring() const -> bool { return true; }
+  auto VerticalMirroring() const -> bool { return !m_reg.horizontal; }
+
+  auto CountsScanlines() const -> bool { return true; }
+  auto ClockScanline() -> bool;
+  auto ObserveA12(bool high, std::uint64_t dot) -> bool;
+  auto IrqPending() const -> bool { return m_reg.irq_pending; }
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
+
+private:
+  // A12 has to stay low for roughly three M2 cycles before a rising edge clocks the counter
+  static constexpr std::uint64_t a12_filter_dots = 10;
+
+  // kept together as plain data so SaveState/LoadState can copy it wholesale
+  struct Registers {
+    std::array<byte_t, 8> bank_data = {};
+    byte_t bank_select = 0;
+    bool horizontal = false;
+
+    byte_t irq_latch = 0;
+    byte_t irq_counter = 0;
+    bool irq_reload = false;
+    bool irq_enabled = false;
+    bool irq_pending = false;
+
+    bool a12 = false;
+    std::uint64_t a12_low_since = 0;
+  };
+
+  Registers m_reg = {};
+
+  auto PrgOffset(addr_t addr) const -> size_t;
+  auto ChrOffset(addr_t addr) const -> size_t;
+};
+
+}  // namespace nes
@@ -0,0 +1,72 @@
+#include "nes/movie.hpp"
+
+#include <fstream>
+
+namespace nes {
+
+auto Movie::Save(string const& file) const -> bool {
+  auto out = std::ofstream{file, std::ios::binary};
+  if (!out) {
+    LOG_WARN("Could not write movie file '" + file + '\'');
+    return false;
+  }
+
+  auto header = Header{};
+  header.rom_hash = rom_hash;
+  header.frames = inputs.size();
+
+  out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  out.write(reinterpret_cast<char const*>(start.get()), sizeof(Snapshot));
+  out.write(reinterpret_cast<char const*>(inputs.data()),
+            static_cast<std::streamsize>(inputs.size() * sizeof(Input)));
+  if (!out) {
+    LOG_WARN("Could not write movie file '" + file + '\'');
+    return false;
+  }
+
+  LOG_DEBUG("Saved " + std::to_string(inputs.size()) + " frame movie to '" + file + '\'');
+  return true;
+}
+
+auto Movie::Load(string const& file) -> bool {
+  auto in = std::ifstream{file, std::ios::binary};
+  if (!in) {
+    LOG_WARN("Could not read movie file '" + file + '\'');
+    return false;
+  }
+
+  auto header = Header{};
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || header.magic != magic_value || header.version != current_version ||
+      header.snapshot_size != sizeof(Snapshot)) {
+    LOG_WARN("Movie file '" + file + "' is not compatible with this version of ReNES");
+    return false;
+  }
+
+  in.read(reinterpret_cast<char*>(start.get()), sizeof(Snapshot));
+  if (!in || !start->Valid()) {
+    LOG_WARN("Movie file '" + file + "' is not compatible with this version of ReNES");
+    return false;
+  }
+
+  auto pos = in.tellg();
+  in.seekg(0, std::ios::end);
+  if (static_cast<std::uint64_t>(in.tellg() - pos) != header.frames * sizeof(Input)) {
+    LOG_WARN("Movie file '" + file + "' is truncated");
+    return false;
+  }
+  in.seekg(pos);
+
+  rom_hash = header.rom_hash;
+  inputs.resize(header.frames);
+  in.read(reinterpret_cast<char*>(inputs.data()),
+          static_cast<std::streamsize>(inputs.size() * sizeof(Input)));
+  if (!in) {
+    LOG_WARN("Could not read movie file '" + file + '\'');
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace nes
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/snapshot.hpp"
+
+namespace nes {
+
+// A recording of the controller input for every frame of a run, starting from a snapshot. The
+// emulator is deterministic, so replaying the input on the same ROM reproduces the run exactly.
+//
+// File layout: the header below, the starting snapshot, then one `Input` per frame.
+struct Movie {
+  static constexpr std::uint32_t magic_value = 0x564D'4E52;  // "RNMV"
+  static constexpr std::uint32_t current_version = 1;
+
+  // one byte per controller port: A, B, Select, Start, Up, Down, Left, Right from bit 0 up
+  using Input = std::array<byte_t, 2>;
+
+  struct Header {
+    std::uint32_t magic = magic_value;
+    std::uint32_t version = current_version;
+    std::uint64_t rom_hash = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t snapshot_size = sizeof(Snapshot);
+  };
+
+  std::uint64_t rom_hash = 0;
+  std::unique_ptr<Snapshot> start = std::make_unique<Snapshot>();
+  std::vector<Input> inputs = {};
+
+  auto Save(string const& file) const -> bool;
+  auto Load(string const& file) -> bool;
+};
+
+}  // namespace nes
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "nes/apu.hpp"
 #include "nes/bus.hpp"
 #include "nes/common.hpp"
 #include "nes/console.hpp"
@@ -7,4 +8,5 @@
 #include "nes/display.hpp"
 #include "nes/locations.hpp"
 #include "nes/logger.hpp"
+#include "nes/trace.hpp"
 #include "nes/utility.hpp"
\ No newline at end of file
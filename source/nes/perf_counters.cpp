@@ -0,0 +1,113 @@
+#include "nes/perf_counters.hpp"
+
+#include <algorithm>
+
+#include "nes/utility.hpp"
+
+namespace nes {
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+PerfCounters::PerfCounters() {
+  // the cheapest back-to-back pair of clock reads is about what each sample pays for being timed
+  m_clock_overhead = Clock::duration::max();
+  for (auto i = 0; i < 256; ++i) {
+    auto start = Clock::now();
+    m_clock_overhead = std::min(m_clock_overhead, Clock::now() - start);
+  }
+  Restart();
+}
+
+void PerfCounters::Restart() {
+  m_restarted = true;
+  m_fps_window_start = Clock::now();
+  m_fps_window_frames = 0;
+}
+
+void PerfCounters::BeginFrame(std::uint64_t cycles, std::uint64_t instructions) {
+  if (!m_host_opened) {
+    m_host_opened = true;
+    m_stats.host_counters = m_host.Open();
+  }
+  m_host_start = m_host.Read();
+
+  m_frame_start = Clock::now();
+  m_start_cycles = cycles;
+  m_start_instructions = instructions;
+  m_steps = {};
+  m_end_frame = {};
+  m_cpu_samples = {};
+  m_ppu_samples = {};
+  m_apu_samples = {};
+}
+
+void PerfCounters::AddSample(Clock::time_point start, Clock::time_point cpu, Clock::time_point apu,
+                             Clock::time_point ppu) {
+  auto Adjust = [&](Clock::duration time) {
+    return std::max(time - m_clock_overhead, Clock::duration::zero());
+  };
+  m_cpu_samples += Adjust(cpu - start);
+  m_apu_samples += Adjust(apu - cpu);
+  m_ppu_samples += Adjust(ppu - apu);
+}
+
+void PerfCounters::AddSteps(Clock::duration time) { m_steps += time; }
+
+void PerfCounters::AddEndFrame(Clock::duration time) { m_end_frame += time; }
+
+void PerfCounters::EndFrame(std::uint64_t cycles, std::uint64_t instructions) {
+  using Nanoseconds = std::chrono::duration<double, std::nano>;
+  using Milliseconds = std::chrono::duration<float, std::milli>;
+
+  auto now = Clock::now();
+  auto& stats = m_stats;
+  stats.host = m_host.Read() - m_host_start;
+  ++stats.frames;
+  stats.cycles = cycles - m_start_cycles;
+  stats.instructions = instructions - m_start_instructions;
+  stats.work_ns = Nanoseconds{now - m_frame_start}.count();
+  stats.end_frame_ns = Nanoseconds{m_end_frame}.count();
+
+  auto steps_ns = Nanoseconds{m_steps}.count();
+  auto sampled = m_cpu_samples + m_ppu_samples + m_apu_samples;
+  if (sampled > Clock::duration::zero()) {
+    auto Share = [&](Clock::duration samples) {
+      return steps_ns * Nanoseconds{samples}.count() / Nanoseconds{sampled}.count();
+    };
+    stats.cpu_ns = Share(m_cpu_samples);
+    stats.ppu_ns = Share(m_ppu_samples);
+    stats.apu_ns = Share(m_apu_samples);
+  }
+
+  ++m_fps_window_frames;
+  auto window = std::chrono::duration<double>{now - m_fps_window_start}.count();
+  if (window >= 0.5) {
+    stats.fps = m_fps_window_frames / window;
+    m_fps_window_start = now;
+    m_fps_window_frames = 0;
+  }
+
+  if (!m_restarted) {
+    m_frame_ms[m_history++ % history_size] = Milliseconds{now - m_last_frame_end}.count();
+  }
+  m_restarted = false;
+  m_last_frame_end = now;
+
+  // percentiles lag by up to a few dozen frames, which keeps them off every frame's bill
+  if (stats.frames % percentile_interval == 0 && m_history > 0) {
+    auto samples = m_frame_ms;
+    auto count = std::min(m_history, history_size);
+    stats.frame_ms_p50 = Percentile(samples.begin(), count, 0.50);
+    stats.frame_ms_p90 = Percentile(samples.begin(), count, 0.90);
+    stats.frame_ms_p99 = Percentile(samples.begin(), count, 0.99);
+    stats.frame_ms_max = *std::max_element(samples.begin(), samples.begin() + count);
+  }
+
+  m_published.Store(stats);
+}
+
+auto PerfCounters::Get() const -> PerfStats { return m_published.Load(); }
+
+}  // namespace nes
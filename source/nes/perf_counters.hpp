@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "nes/common.hpp"
+#include "nes/hw_counters.hpp"
+#include "nes/seq_lock.hpp"
+
+namespace nes {
+
+// What the console spent on its most recent frame, plus rates over the last few hundred frames.
+// Host times are in nanoseconds.
+struct PerfStats {
+  std::uint64_t frames = 0;        // frames counted since the counters were enabled
+  std::uint64_t cycles = 0;        // CPU cycles emulated in the last frame
+  std::uint64_t instructions = 0;  // CPU instructions retired in the last frame
+
+  // all host work for the last frame (including any run-ahead), and an estimate of how the time
+  // spent stepping components split between the CPU, PPU and APU
+  double work_ns = 0.0;
+  double cpu_ns = 0.0;
+  double ppu_ns = 0.0;
+  double apu_ns = 0.0;
+  double end_frame_ns = 0.0;  // audio resampling, rewind snapshots and other end-of-frame work
+
+  // the host CPU's own counters for the emulation thread over the same work, when the kernel
+  // lets us read them (see HwCounters); a counter the host doesn't provide stays zero
+  bool host_counters = false;
+  HwCounts host = {};
+
+  double fps = 0.0;  // over roughly the last half second of host time
+
+  // time from the end of one frame to the end of the next, pacing included
+  double frame_ms_p50 = 0.0;
+  double frame_ms_p90 = 0.0;
+  double frame_ms_p99 = 0.0;
+  double frame_ms_max = 0.0;
+};
+
+// Collects PerfStats on the emulation thread and publishes them once per frame for any thread to
+// read. Timing every step would cost more than the steps themselves, so only one CPU cycle in
+// `sample_period` has its CPU, APU and PPU steps timed individually. Those samples split the
+// measured time for the whole frame.
+class PerfCounters {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::uint64_t sample_period = 512;  // CPU cycles; a power of two
+
+  PerfCounters();
+
+  // forgets when the last frame ended, so a pause doesn't show up as one very long frame
+  void Restart();
+
+  // `cycles` and `instructions` are running totals
+  void BeginFrame(std::uint64_t cycles, std::uint64_t instructions);
+  void AddSample(Clock::time_point start, Clock::time_point cpu, Clock::time_point apu,
+                 Clock::time_point ppu);
+  void AddSteps(Clock::duration time);
+  void AddEndFrame(Clock::duration time);
+  void EndFrame(std::uint64_t cycles, std::uint64_t instructions);
+
+  // safe to call from any thread
+  auto Get() const -> PerfStats;
+
+private:
+  static constexpr size_t history_size = 256;
+  static constexpr std::uint64_t percentile_interval = 32;  // frames
+
+  Clock::duration m_clock_overhead = {};  // subtracted from every sample
+  Clock::time_point m_frame_start = {};
+  Clock::time_point m_last_frame_end = {};
+  Clock::time_point m_fps_window_start = {};
+  std::uint64_t m_fps_window_frames = 0;
+  bool m_restarted = true;
+
+  // this frame so far
+  std::uint64_t m_start_cycles = 0;
+  std::uint64_t m_start_instructions = 0;
+  Clock::duration m_steps = {};
+  Clock::duration m_end_frame = {};
+  Clock::duration m_cpu_samples = {};
+  Clock::duration m_ppu_samples = {};
+  Clock::duration m_apu_samples = {};
+  HwCounts m_host_start = {};
+
+  // opened by the first frame, so that they count the thread running the console
+  HwCounters m_host = {};
+  bool m_host_opened = false;
+
+  std::array<float, history_size> m_frame_ms = {};
+  size_t m_history = 0;
+
+  PerfStats m_stats = {};
+  SeqLock<PerfStats> m_published = {};
+};
+
+}  // namespace nes
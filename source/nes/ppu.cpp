@@ -13,6 +13,10 @@ void Ppu::AttachCartridge(Cartridge* cartridge) { m_cartridge = AssumeNotNull(ca
 void Ppu::AttachDisplay(Display* display) { m_display = AssumeNotNull(display); }
 
 void Ppu::Step() {
+  if (m_col == 0 && (m_row < Row::screen_height || m_row == Row::pre_render)) {
+    PredictScanlineCounter();
+  }
+
   // The PPU skips the point (340, 261) on odd frames. This is equivalent to skipping the idle
   // step at (0, 0), and letting scanline 261 be a full render line. This only happens when
   // rendering is enabled.
@@ -20,21 +24,59 @@ void Ppu::Step() {
     if (ShowFg() || ShowBg()) { m_col = m_frame_odd ? 1 : 0; }
   }
 
-  if (m_row < Row::screen_height || m_row == Row::pre_render) { RenderCycle(); }
+  if (m_row < Row::screen_height || m_row == Row::pre_render) {
+    RenderCycle();
+    if (m_scanline_counter_col && m_col == m_scanline_counter_col) ClockScanlineCounter();
+  }
   if (m_row == Row::vblank_clear && m_col == Col::vblank_clear) {
-    LOG_TRACE("[PPU] Clearing VBLANK");
+    LOG_TRACE_IN(Ppu, "Clearing VBLANK");
     VBlank(false);
   }
   if ((m_row == Row::vblank_set) && (m_col == Col::vblank_set)) {
-    LOG_TRACE("[PPU] Setting VBLANK");
+    LOG_TRACE_IN(Ppu, "Setting VBLANK");
     VBlank(true);
     if (GenNmi()) {
-      LOG_TRACE("[PPU] Requesting NMI");
+      LOG_TRACE_IN(Ppu, "Requesting NMI");
       m_bus->RequestNmi();
     }
   }
 
-  DrawPixel();
+  if (m_output_enabled) DrawPixel();
+  NextDot();
+}
+
+auto Ppu::FrameCount() const -> std::uint64_t { return m_frame_count; }
+
+void Ppu::SetOutputEnabled(bool enabled) { m_output_enabled = enabled; }
+
+void Ppu::SaveState(State& state) const {
+  state.reg = m_reg;
+  state.row = m_row;
+  state.col = m_col;
+  state.frame_odd = m_frame_odd;
+  state.track_a12 = m_track_a12;
+  state.scanline_counter_col = m_scanline_counter_col;
+  state.frame_count = m_frame_count;
+  state.dots = m_dots;
+  state.pattern_tables = m_pattern_tables;
+  state.name_tables = m_name_tables;
+  state.palette_table = m_palette_table;
+  state.sprites = m_sprites;
+}
+
+void Ppu::LoadState(State const& state) {
+  m_reg = state.reg;
+  m_row = state.row;
+  m_col = state.col;
+  m_frame_odd = state.frame_odd;
+  m_track_a12 = state.track_a12;
+  m_scanline_counter_col = state.scanline_counter_col;
+  m_frame_count = state.frame_count;
+  m_dots = state.dots;
+  m_pattern_tables = state.pattern_tables;
+  m_name_tables = state.name_tables;
+  m_palette_table = state.palette_table;
+  m_sprites = state.sprites;
 }
 
 // ----------------------------------------------
@@ -59,14 +101,17 @@ void Ppu::DrawPixel() {
   byte_t pixel = Read(addr) & 0x3F;
   auto color = pallete[pixel];
   m_display->DrawPixel(m_col - 1, m_row, color);
+}
 
-  // move to next pixel
+void Ppu::NextDot() {
+  ++m_dots;
   if (++m_col > Col::max) {
     m_col = 0;
     if (++m_row > Row::max) {
       m_row = 0;
       m_frame_odd = !m_frame_odd;
-      LOG_TRACE("[PPU] End frame");
+      ++m_frame_count;
+      LOG_TRACE_IN(Ppu, "End frame");
     }
   }
 }
@@ -82,13 +127,13 @@ auto Ppu::Read(addr_t addr) const -> byte_t {
     auto which = addr / 0x0400;
     addr %= 0x0400;
 
-    auto mirroring = m_cartridge->GetInfo().mirror_mode;
+    auto mirroring = m_cartridge->GetMirrorMode();
     switch (mirroring) {
     case Cartridge::MirrorMode::Horizontal: which /= 2; break;
     case Cartridge::MirrorMode::Vertical: which %= 2; break;
     case Cartridge::MirrorMode::FourScreen: break;
     default:
-      LOG_ERROR("[PPU] Unknown mirroring mode detected");
+      LOG_ERROR_IN(Ppu, "Unknown mirroring mode detected");
       throw std::runtime_error("Unknown mirroring mode detected");
     }
 
@@ -115,13 +160,13 @@ void Ppu::Write(addr_t addr, byte_t value) {
     auto which = addr / 0x0400;
     addr %= 0x0400;
 
-    auto mirroring = m_cartridge->GetInfo().mirror_mode;
+    auto mirroring = m_cartridge->GetMirrorMode();
     switch (mirroring) {
     case Cartridge::MirrorMode::Horizontal: which /= 2; break;
     case Cartridge::MirrorMode::Vertical: which %= 2; break;
     case Cartridge::MirrorMode::FourScreen: break;
     default:
-      LOG_ERROR("[PPU] Unknown mirroring mode detected");
+      LOG_ERROR_IN(Ppu, "Unknown mirroring mode detected");
       throw std::runtime_error("Unknown mirroring mode detected");
     }
 
@@ -135,7 +180,7 @@ void Ppu::Write(addr_t addr, byte_t value) {
     case 0x1C: addr -= 0x10; break;
     }
     m_palette_table[addr] = value;
-    LOG_TRACE("[PPU] Writing to palette table");
+    LOG_TRACE_IN(Ppu, "Writing to palette table");
   }
 }
 
@@ -209,6 +254,7 @@ void Ppu::RenderCycle() {
     case 1:
       addr = 0x2000 + (m_reg.v % 0x1000);
       m_reg.bg_next_nt = Read(addr);
+      TrackA12(addr);
       break;
     case 3:
       coarse_x >>= 2;
@@ -216,16 +262,19 @@ void Ppu::RenderCycle() {
       nt <<= 10;
       addr = 0x23C0 | nt | coarse_y | coarse_x;
       m_reg.bg_next_at = Read(addr);
+      TrackA12(addr);
       if (coarse_x & 0x02) m_reg.bg_next_at >>= 2;
       if (coarse_y & 0x02) m_reg.bg_next_at >>= 4;
       break;
     case 5:
       addr = (0x1000 * BgTable()) + (m_reg.bg_next_nt << 4) + fine_y + 0;
       m_reg.bg_next_id = Read(addr);
+      TrackA12(addr);
       break;
     case 7:
       addr = (0x1000 * BgTable()) + (m_reg.bg_next_nt << 4) + fine_y + 8;
       m_reg.bg_next_id |= Read(addr) << 8;
+      TrackA12(addr);
       break;
     default:
       // each of the above loads takes 2 cycles - we mimic this by skipping loads on even cycles
@@ -238,7 +287,9 @@ void Ppu::RenderCycle() {
       auto mask = 0b0000'0100'0001'1111;
       m_reg.v = (m_reg.v & ~mask) | (m_reg.t & mask);
     }
+    TrackSpriteFetches();
   } else if (m_col <= 320) {
+    TrackSpriteFetches();
     if (m_row == Row::pre_render && (280 <= m_col && m_col <= 304)) {
       if (ShowFg() || ShowBg()) {
         auto mask = 0b0111'1011'1110'0000;
@@ -251,6 +302,52 @@ void Ppu::RenderCycle() {
   }
 }
 
+// The MMC3 scanline counter is clocked by rising edges of PPU A12. When the background and sprites
+// use different pattern tables with 8x8 sprites, that edge happens exactly once per rendered line
+// at a fixed dot, so the counter is clocked there directly. Other setups (8x16 sprites, or both
+// using the same table) fall back to feeding every fetch address through the mapper's A12 filter.
+void Ppu::PredictScanlineCounter() {
+  m_scanline_counter_col = 0;
+  m_track_a12 = false;
+  if (!(ShowFg() || ShowBg()) || !m_cartridge->CountsScanlines()) return;
+
+  if (!BigSprites() && (BgTable() != SpriteTable())) {
+    m_scanline_counter_col = SpriteTable() ? Col::sprite_a12_rise : Col::bg_a12_rise;
+  } else {
+    m_track_a12 = true;
+  }
+}
+
+void Ppu::ClockScanlineCounter() {
+  // registers may have changed since the prediction was made earlier in this line
+  if (!(ShowFg() || ShowBg()) || BigSprites() || (BgTable() == SpriteTable())) return;
+  if (m_cartridge->ClockScanline()) {
+    LOG_TRACE_IN(Ppu, "Mapper requesting IRQ");
+    m_bus->SetIrq(Cpu::IrqSource::Mapper, true);
+  }
+}
+
+void Ppu::TrackA12(addr_t addr) {
+  if (!m_track_a12 || !(ShowFg() || ShowBg())) return;
+  if (m_cartridge->ObserveA12(TestBit(addr, 12), m_dots)) {
+    LOG_TRACE_IN(Ppu, "Mapper requesting IRQ");
+    m_bus->SetIrq(Cpu::IrqSource::Mapper, true);
+  }
+}
+
+void Ppu::TrackSpriteFetches() {
+  if (!m_track_a12) return;
+
+  // sprite evaluation isn't implemented yet, so every slot fetches the dummy tile $FF - only the
+  // pattern table it comes from (and hence A12) matters to the mapper
+  switch ((m_col - Col::sprite_fetch_area) % 8) {
+  case 0: [[fallthrough]];
+  case 2: TrackA12(locations::name_table_0); break;
+  case 4: [[fallthrough]];
+  case 6: TrackA12(BigSprites() || SpriteTable() ? locations::pattern_table_1 : 0); break;
+  }
+}
+
 void Ppu::IncrementHorizV() {
   if (ShowFg() || ShowBg()) {
     if ((m_reg.v & 0x001F) == 0x001F) {
@@ -25,10 +25,13 @@ class Ppu {
 
   struct Col {
     static constexpr uint screen_width = Display::Width();
+    static constexpr uint sprite_fetch_area = 257;
     static constexpr uint sprite_prefetch_area = 321;
     static constexpr uint tile_prefetch_area = 337;
     static constexpr uint vblank_set = 1;
     static constexpr uint vblank_clear = 1;
+    static constexpr uint sprite_a12_rise = 261;  // first sprite pattern fetch
+    static constexpr uint bg_a12_rise = 325;      // first background prefetch pattern fetch
     static constexpr uint max = 340;
   };
 
@@ -41,7 +44,7 @@ public:
     byte_t control = 0;
     byte_t mask = 0;
     byte_t status = 0;
-    byte_t data = 0;
+    byte_t data = 0;  // read buffer for delayed PPUDATA reads
     byte_t oam_address = 0;
     byte_t oam_data = 0;
     byte_t oam_dma = 0;
@@ -70,6 +73,21 @@ public:
     byte_t attr;
   };
 
+  struct State {
+    Registers reg;
+    uint row;
+    uint col;
+    bool frame_odd;
+    bool track_a12;
+    uint scanline_counter_col;
+    std::uint64_t frame_count;
+    std::uint64_t dots;
+    std::array<PatternTable, 2> pattern_tables;
+    std::array<NameTable, 4> name_tables;
+    std::array<byte_t, 0x20> palette_table;
+    std::array<Sprite, 64> sprites;
+  };
+
   void Reset();
 
   void AttachBus(Bus* bus);
@@ -78,6 +96,14 @@ public:
 
   void Step();
 
+  auto FrameCount() const -> std::uint64_t;
+
+  // with output disabled the PPU keeps running but never touches the display
+  void SetOutputEnabled(bool enabled);
+
+  void SaveState(State& state) const;
+  void LoadState(State const& state);
+
 private:
   Bus* m_bus = nullptr;
   Display* m_display = nullptr;
@@ -86,6 +112,13 @@ private:
   uint m_row = 261;  // often called scanlines
   uint m_col = 0;    // often called cycles or dots
   bool m_frame_odd = false;
+  std::uint64_t m_frame_count = 0;
+  bool m_output_enabled = true;
+  std::uint64_t m_dots = 0;  // dots since power on, used to time mapper A12 filtering
+
+  // mapper scanline counter state - see PredictScanlineCounter
+  uint m_scanline_counter_col = 0;
+  bool m_track_a12 = false;
 
   Registers m_reg = {};
   std::array<PatternTable, 2> m_pattern_tables = {};
@@ -94,6 +127,7 @@ private:
   std::array<Sprite, 64> m_sprites = {};  // also called OAM - Object Attribute Memory
 
   void DrawPixel();
+  void NextDot();
 
   auto Read(addr_t addr) const -> byte_t;
   void Write(addr_t addr, byte_t value);
@@ -151,6 +185,11 @@ private:
 
   void RenderCycle();
 
+  void PredictScanlineCounter();
+  void ClockScanlineCounter();
+  void TrackA12(addr_t addr);
+  void TrackSpriteFetches();
+
   void IncrementHorizV();
   void IncrementVertV();
   void PrepareShiftRegisters();
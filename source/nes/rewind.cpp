@@ -0,0 +1,165 @@
+#include "nes/rewind.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace nes {
+
+namespace {
+
+  // The kernels below work on whole 64-bit words with simple, branch-light loops so that the
+  // compiler can vectorize them. A compressed stream is a sequence of runs, each a 32-bit header
+  // (number of zero words, then number of literal words, 16 bits each) followed by the literals.
+
+  void XorWords(std::uint64_t* dst, std::uint64_t const* a, std::uint64_t const* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = a[i] ^ b[i];
+  }
+
+  auto MaxCompressedSize(size_t n) -> size_t { return n * 12 + 4; }
+
+  auto Compress(std::uint64_t const* words, size_t n, byte_t* out) -> size_t {
+    constexpr size_t max_run = 0xFFFF;
+
+    auto* start = out;
+    size_t i = 0;
+    while (i < n) {
+      std::uint32_t zeros = 0;
+      while (i < n && words[i] == 0 && zeros < max_run) ++zeros, ++i;
+
+      std::uint32_t literals = 0;
+      auto first = i;
+      while (i < n && words[i] != 0 && literals < max_run) ++literals, ++i;
+
+      auto header = zeros | (literals << 16);
+      std::memcpy(out, &header, sizeof(header));
+      out += sizeof(header);
+      std::memcpy(out, words + first, literals * sizeof(std::uint64_t));
+      out += literals * sizeof(std::uint64_t);
+    }
+    return static_cast<size_t>(out - start);
+  }
+
+  // XORs the decompressed words into `words`, so the same routine restores keyframes (into zeroed
+  // words) and applies deltas (onto the keyframe)
+  void DecompressXor(byte_t const* in, size_t size, std::uint64_t* words) {
+    auto* end = in + size;
+    size_t i = 0;
+    while (in < end) {
+      std::uint32_t header = 0;
+      std::memcpy(&header, in, sizeof(header));
+      in += sizeof(header);
+
+      i += header & 0xFFFF;
+      auto literals = header >> 16;
+      for (std::uint32_t j = 0; j < literals; ++j, ++i) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, in, sizeof(word));
+        in += sizeof(word);
+        words[i] ^= word;
+      }
+    }
+  }
+
+}  // namespace
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+RewindBuffer::RewindBuffer(size_t budget)
+  : m_arena(std::max(budget, min_budget)), m_compressed(MaxCompressedSize(words)) {}
+
+void RewindBuffer::Push(Snapshot const& snapshot) {
+  auto& current = *m_delta;
+  current.back() = 0;
+  std::memcpy(current.data(), &snapshot, sizeof(snapshot));
+
+  if (m_have_keyframe && m_since_keyframe < keyframe_interval) {
+    XorWords(current.data(), current.data(), m_keyframe->data(), words);
+    auto size = Compress(current.data(), words, m_compressed.data());
+    if (Store(size, false)) {
+      ++m_since_keyframe;
+      return;
+    }
+
+    // storing the delta evicted its own keyframe, so start a new group
+    XorWords(current.data(), current.data(), m_keyframe->data(), words);
+  }
+
+  *m_keyframe = current;
+  auto size = Compress(current.data(), words, m_compressed.data());
+  m_have_keyframe = Store(size, true);
+  m_since_keyframe = 1;
+}
+
+auto RewindBuffer::Rewind(size_t frames, Snapshot& snapshot) -> bool {
+  if (frames >= m_entries.size()) return false;
+
+  // drop everything newer than the target frame
+  m_entries.erase(m_entries.end() - static_cast<std::ptrdiff_t>(frames), m_entries.end());
+  auto const& entry = m_entries.back();
+  m_head = entry.offset + entry.size;
+
+  auto key = std::find_if(m_entries.rbegin(), m_entries.rend(), [](auto& e) { return e.keyframe; });
+  m_since_keyframe = static_cast<size_t>(key - m_entries.rbegin()) + 1;
+
+  auto& words = *m_delta;
+  Restore(*key, *m_keyframe);
+  words = *m_keyframe;
+  if (!entry.keyframe) DecompressXor(&m_arena[entry.offset], entry.size, words.data());
+
+  std::memcpy(static_cast<void*>(&snapshot), words.data(), sizeof(snapshot));
+  return true;
+}
+
+void RewindBuffer::Clear() {
+  m_entries.clear();
+  m_head = 0;
+  m_since_keyframe = 0;
+  m_have_keyframe = false;
+}
+
+auto RewindBuffer::BytesUsed() const -> size_t {
+  auto used = size_t{0};
+  for (auto const& entry : m_entries) used += entry.size;
+  return used;
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+// Copies the compressed scratch buffer into the arena, evicting old groups to make room. Returns
+// false if a delta could not be stored because its keyframe had to be evicted.
+auto RewindBuffer::Store(size_t size, bool keyframe) -> bool {
+  if (size > m_arena.size()) return false;
+  if (m_head + size > m_arena.size()) {
+    // wrap around - anything still stored past the head is older than what's at the start
+    while (!m_entries.empty() && m_entries.front().offset >= m_head) Evict();
+    m_head = 0;
+  }
+
+  auto Overlaps = [&](Entry const& e) {
+    return e.offset < m_head + size && m_head < e.offset + e.size;
+  };
+  while (!m_entries.empty() && Overlaps(m_entries.front())) Evict();
+  if (!keyframe && m_entries.empty()) return false;
+
+  std::memcpy(&m_arena[m_head], m_compressed.data(), size);
+  m_entries.push_back({m_head, size, keyframe});
+  m_head += size;
+  return true;
+}
+
+void RewindBuffer::Evict() {
+  // deltas are useless without their keyframe, so a whole group goes at once
+  m_entries.pop_front();
+  while (!m_entries.empty() && !m_entries.front().keyframe) m_entries.pop_front();
+}
+
+void RewindBuffer::Restore(Entry const& entry, Words& words) const {
+  words.fill(0);
+  DecompressXor(&m_arena[entry.offset], entry.size, words.data());
+}
+
+}  // namespace nes
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/snapshot.hpp"
+
+namespace nes {
+
+// Keeps a history of per-frame snapshots in a fixed memory budget. Every `keyframe_interval`
+// frames a full snapshot is stored as a keyframe; the frames in between are stored as the XOR of
+// their snapshot against that keyframe. Since most of the state doesn't change from frame to
+// frame, the XOR is mostly zero words, which the compressor collapses into runs.
+//
+// Compressed frames live in a single ring-shaped arena; when it fills up, the oldest keyframe and
+// all of the deltas depending on it are dropped together.
+class RewindBuffer {
+public:
+  static constexpr size_t min_budget = size_t{1} << 20;
+  static constexpr size_t keyframe_interval = 60;
+
+  explicit RewindBuffer(size_t budget);
+
+  void Push(Snapshot const& snapshot);
+  auto Rewind(size_t frames, Snapshot& snapshot) -> bool;
+  void Clear();
+
+  auto Frames() const -> size_t { return m_entries.size(); }
+  auto Budget() const -> size_t { return m_arena.size(); }
+  auto BytesUsed() const -> size_t;
+
+private:
+  static constexpr size_t words = (sizeof(Snapshot) + 7) / 8;
+
+  using Words = std::array<std::uint64_t, words>;
+
+  struct Entry {
+    size_t offset;
+    size_t size;
+    bool keyframe;
+  };
+
+  std::vector<byte_t> m_arena;
+  std::deque<Entry> m_entries;
+  size_t m_head = 0;
+  size_t m_since_keyframe = 0;
+  bool m_have_keyframe = false;
+
+  // scratch space, allocated once
+  std::unique_ptr<Words> m_keyframe = std::make_unique<Words>();
+  std::unique_ptr<Words> m_delta = std::make_unique<Words>();
+  std::vector<byte_t> m_compressed;
+
+  auto Store(size_t size, bool keyframe) -> bool;
+  void Evict();
+  void Restore(Entry const& entry, Words& words) const;
+};
+
+}  // namespace nes
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Lock-free ring of audio samples between the emulation thread, which writes a frame's worth at a
+// time, and a single consumer (an audio callback or a file writer). Samples that don't fit are
+// dropped and counted rather than blocking emulation.
+class SampleRing {
+public:
+  explicit SampleRing(size_t capacity) : m_samples(std::max<size_t>(2, Pow2(capacity))) {}
+
+  // producer only
+  auto Write(std::int16_t const* samples, size_t count) -> size_t {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    auto head = m_head.load(std::memory_order_acquire);
+    auto n = std::min(count, m_samples.size() - (tail - head));
+    for (auto i = size_t{0}; i < n; ++i) m_samples[(tail + i) & Mask()] = samples[i];
+    m_tail.store(tail + n, std::memory_order_release);
+
+    if (n < count) m_dropped.fetch_add(count - n, std::memory_order_relaxed);
+    return n;
+  }
+
+  // consumer only
+  auto Read(std::int16_t* samples, size_t count) -> size_t {
+    auto head = m_head.load(std::memory_order_relaxed);
+    auto tail = m_tail.load(std::memory_order_acquire);
+    auto n = std::min(count, tail - head);
+    for (auto i = size_t{0}; i < n; ++i) samples[i] = m_samples[(head + i) & Mask()];
+    m_head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  auto Available() const -> size_t {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+  auto Capacity() const -> size_t { return m_samples.size(); }
+  auto Dropped() const -> std::uint64_t { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr size_t cache_line = 64;
+
+  alignas(cache_line) std::atomic<size_t> m_head = 0;
+  alignas(cache_line) std::atomic<size_t> m_tail = 0;
+  alignas(cache_line) std::atomic<std::uint64_t> m_dropped = 0;
+  std::vector<std::int16_t> m_samples;
+
+  auto Mask() const -> size_t { return m_samples.size() - 1; }
+
+  static auto Pow2(size_t n) -> size_t {
+    auto p = size_t{1};
+    while (p < n) p <<= 1;
+    return p;
+  }
+};
+
+}  // namespace nes
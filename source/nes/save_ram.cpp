@@ -0,0 +1,142 @@
+#include "nes/save_ram.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define RENES_HAS_MMAP
+#endif
+
+namespace nes {
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+SaveRam::~SaveRam() { Release(); }
+
+void SaveRam::Allocate(size_t size) {
+  Release();
+  m_memory.assign(size, 0);
+  m_data = m_memory.data();
+  m_size = size;
+  m_mask = size - 1;
+}
+
+auto SaveRam::Map(string const& file, size_t size) -> bool {
+  Release();
+
+#if defined(RENES_HAS_MMAP)
+  auto fd = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    LOG_WARN("... Could not open save file '" + file + '\'');
+    return false;
+  }
+
+  // grow (but never shrink) the save file so an existing save is preserved as-is
+  struct stat info = {};
+  if (::fstat(fd, &info) != 0 ||
+      (static_cast<size_t>(info.st_size) < size && ::ftruncate(fd, size) != 0)) {
+    LOG_WARN("... Could not resize save file '" + file + '\'');
+    ::close(fd);
+    return false;
+  }
+
+  auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    LOG_WARN("... Could not map save file '" + file + '\'');
+    ::close(fd);
+    return false;
+  }
+
+  m_fd = fd;
+  m_data = static_cast<byte_t*>(data);
+  m_size = size;
+  m_mask = size - 1;
+  m_stopping = false;
+  m_flusher = std::thread{&SaveRam::FlushLoop, this};
+
+  LOG_DEBUG("... Mapped battery-backed RAM to '" + file + '\'');
+  return true;
+#else
+  LOG_WARN("... Battery-backed RAM is not supported on this platform; '" + file +
+           "' will not be written");
+  Allocate(size);
+  return false;
+#endif
+}
+
+void SaveRam::Release() {
+  if (m_flusher.joinable()) {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_flusher.join();
+  }
+
+#if defined(RENES_HAS_MMAP)
+  if (m_fd >= 0) {
+    Flush();
+    ::munmap(m_data, m_size);
+    ::close(m_fd);
+    m_fd = -1;
+  }
+#endif
+
+  m_memory.clear();
+  m_data = nullptr;
+  m_size = 0;
+  m_mask = 0;
+}
+
+void SaveRam::CopyTo(byte_t* data, size_t size) const {
+  std::copy_n(m_data, std::min(size, m_size), data);
+}
+
+void SaveRam::CopyFrom(byte_t const* data, size_t size) {
+  // restores (run-ahead, rewind) happen every frame and almost never change the RAM; leaving it
+  // clean then keeps them from syncing the save file each time
+  size = std::min(size, m_size);
+  if (std::equal(data, data + size, m_data)) return;
+  std::copy_n(data, size, m_data);
+  m_dirty.store(true, std::memory_order_relaxed);
+}
+
+void SaveRam::EndFrame() {
+  if (m_fd < 0 || !m_dirty.load(std::memory_order_relaxed)) return;
+  {
+    std::lock_guard lock{m_mutex};
+    m_flush_requested = true;
+  }
+  m_cv.notify_one();
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void SaveRam::Flush() {
+#if defined(RENES_HAS_MMAP)
+  // the mapping is shared, so the kernel already holds every write - syncing only guards against
+  // the host itself going down
+  if (m_dirty.exchange(false, std::memory_order_relaxed)) { ::msync(m_data, m_size, MS_SYNC); }
+#endif
+}
+
+void SaveRam::FlushLoop() {
+  auto lock = std::unique_lock{m_mutex};
+  while (true) {
+    m_cv.wait(lock, [this] { return m_flush_requested || m_stopping; });
+    if (m_stopping) return;
+    m_flush_requested = false;
+
+    lock.unlock();
+    Flush();
+    lock.lock();
+  }
+}
+
+}  // namespace nes
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Cartridge work RAM at $6000 - $7FFF. Battery-backed RAM is mapped straight onto a save file so
+// that reads and writes stay plain memory accesses; a background thread syncs dirty RAM back to
+// disk whenever the console signals the end of a frame.
+class SaveRam {
+public:
+  SaveRam() = default;
+  SaveRam(SaveRam const&) = delete;
+  SaveRam& operator=(SaveRam const&) = delete;
+  ~SaveRam();
+
+  void Allocate(size_t size);
+  auto Map(string const& file, size_t size) -> bool;
+  void Release();
+
+  auto Empty() const -> bool { return m_size == 0; }
+  auto Size() const -> size_t { return m_size; }
+  auto Data() -> byte_t* { return m_data; }
+
+  auto Read(addr_t offset) const -> byte_t { return m_data[offset & m_mask]; }
+  void Write(addr_t offset, byte_t value) {
+    m_data[offset & m_mask] = value;
+    m_dirty.store(true, std::memory_order_relaxed);
+  }
+
+  void CopyTo(byte_t* data, size_t size) const;
+  void CopyFrom(byte_t const* data, size_t size);
+
+  void EndFrame();
+
+private:
+  byte_t* m_data = nullptr;
+  size_t m_size = 0;
+  size_t m_mask = 0;
+  std::vector<byte_t> m_memory;
+
+  // file-backed state
+  int m_fd = -1;
+  std::thread m_flusher;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::atomic<bool> m_dirty = false;
+  bool m_flush_requested = false;
+  bool m_stopping = false;
+
+  void Flush();
+  void FlushLoop();
+};
+
+}  // namespace nes
@@ -0,0 +1,120 @@
+#include "nes/scaler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "nes/simd.hpp"
+
+namespace nes {
+
+namespace {
+
+#if defined(RENES_SIMD_X86)
+RENES_TARGET_SSSE3 void ShuffleRow(byte_t const* source, byte_t* out, size_t chunks,
+                                   std::uint16_t const* offsets,
+                                   std::array<byte_t, 16> const* shuffles,
+                                   std::array<byte_t, 16> const& fill) {
+  auto filler = _mm_loadu_si128(reinterpret_cast<__m128i const*>(fill.data()));
+  for (auto i = size_t{0}; i < chunks; ++i) {
+    auto bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + offsets[i]));
+    auto shuffle = _mm_loadu_si128(reinterpret_cast<__m128i const*>(shuffles[i].data()));
+    auto pixels = _mm_or_si128(_mm_shuffle_epi8(bytes, shuffle), filler);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * i), pixels);
+  }
+}
+#endif
+
+}  // namespace
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+void NearestScaler::Configure(uint scale, Layout layout, size_t width, size_t height) {
+  assert(scale > 0 && (layout.bytes_per_pixel == 3 || layout.bytes_per_pixel == 4));
+  assert(3 * width <= INT16_MAX);
+
+  m_scale = scale;
+  m_width = width;
+  m_height = height;
+  m_source_row_bytes = 3 * width;
+  m_row_bytes = width * scale * layout.bytes_per_pixel;
+
+  m_indices.resize(m_row_bytes);
+  for (auto byte = size_t{0}; byte < m_row_bytes; ++byte) {
+    auto pixel = byte / layout.bytes_per_pixel / scale;
+    auto channel = byte % layout.bytes_per_pixel;
+    auto index = std::int16_t{-1};
+    if (channel == layout.red) index = static_cast<std::int16_t>(3 * pixel + 0);
+    if (channel == layout.green) index = static_cast<std::int16_t>(3 * pixel + 1);
+    if (channel == layout.blue) index = static_cast<std::int16_t>(3 * pixel + 2);
+    m_indices[byte] = index;
+  }
+
+  // Each 16 output bytes need at most 16 consecutive source bytes - except at 1x, where 16 bytes
+  // of 3-byte pixels can span 18. Rows of the widths used here are a whole number of chunks.
+  auto chunks = m_row_bytes / 16;
+  m_offsets.resize(chunks);
+  m_shuffles.resize(chunks);
+  m_vectorized = HostHasSsse3() && m_row_bytes % 16 == 0;
+  for (auto chunk = size_t{0}; chunk < chunks && m_vectorized; ++chunk) {
+    auto first = m_indices.begin() + 16 * chunk;
+    auto lowest = std::int16_t{INT16_MAX};
+    for (auto it = first; it != first + 16; ++it) {
+      if (*it >= 0) lowest = std::min(lowest, *it);
+    }
+    // the last load of a row starts early rather than reading past the end of the frame
+    auto offset = std::min<size_t>(lowest, m_source_row_bytes - 16);
+
+    for (auto i = 0; i < 16; ++i) {
+      auto index = first[i];
+      if (index >= 0 && static_cast<size_t>(index) - offset >= 16) m_vectorized = false;
+      m_shuffles[chunk][i] = index < 0 ? 0x80 : static_cast<byte_t>(index - offset);
+    }
+    m_offsets[chunk] = static_cast<std::uint16_t>(offset);
+  }
+
+  for (auto i = size_t{0}; i < m_fill.size(); ++i) {
+    m_fill[i] = m_indices[i % m_row_bytes] < 0 ? 0xFF : 0x00;
+  }
+}
+
+auto NearestScaler::GetScale() const -> uint { return m_scale; }
+
+auto NearestScaler::GetOutputSize() const -> std::array<size_t, 2> {
+  return {m_width * m_scale, m_height * m_scale};
+}
+
+void NearestScaler::Scale(byte_t const* frame, byte_t* out, std::ptrdiff_t stride) const {
+  for (auto row = size_t{0}; row < m_height; ++row) {
+    auto* first = out;
+    ScaleRow(frame + row * m_source_row_bytes, first);
+    out += stride;
+    for (auto copy = 1u; copy < m_scale; ++copy) {
+      std::memcpy(out, first, m_row_bytes);
+      out += stride;
+    }
+  }
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+void NearestScaler::ScaleRow(byte_t const* source, byte_t* out) const {
+#if defined(RENES_SIMD_X86)
+  if (m_vectorized) {
+    ShuffleRow(source, out, m_offsets.size(), m_offsets.data(), m_shuffles.data(), m_fill);
+    return;
+  }
+#endif
+
+  for (auto byte = size_t{0}; byte < m_row_bytes; ++byte) {
+    auto index = m_indices[byte];
+    out[byte] = index < 0 ? 0xFF : source[index];
+  }
+}
+
+}  // namespace nes
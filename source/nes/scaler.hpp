@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/display.hpp"
+
+namespace nes {
+
+// Integer nearest-neighbour upscaling of an RGB frame (a Display's, or a filtered one), written
+// straight in whatever pixel layout the frontend's bitmap uses. Every output row is a fixed
+// shuffle of one source row's bytes, so Configure() works the shuffle out once and Scale() only
+// applies it: 16 output bytes per SSSE3 byte shuffle where the host has one, one byte at a time
+// where it doesn't.
+class NearestScaler {
+public:
+  // where each channel sits within an output pixel; any other byte (alpha) is set to 0xFF
+  struct Layout {
+    uint bytes_per_pixel = 3;
+    uint red = 0;
+    uint green = 1;
+    uint blue = 2;
+  };
+
+  // rebuilds the shuffle, so call it only when the scale, layout or source size changes
+  void Configure(uint scale, Layout layout, size_t width = Display::Width(),
+                 size_t height = Display::Height());
+
+  auto GetScale() const -> uint;
+  auto GetOutputSize() const -> std::array<size_t, 2>;
+
+  // `frame` is packed RGB of the configured size. Output rows are `stride` bytes apart, which may
+  // be negative for bottom-up bitmaps.
+  void Scale(byte_t const* frame, byte_t* out, std::ptrdiff_t stride) const;
+
+private:
+  uint m_scale = 0;
+  size_t m_width = Display::Width();
+  size_t m_height = Display::Height();
+  size_t m_source_row_bytes = Display::Width() * 3;
+  size_t m_row_bytes = 0;
+
+  // per output byte of a row: which source byte it copies, or -1 for 0xFF
+  std::vector<std::int16_t> m_indices;
+
+  // per 16 output bytes of a row: where to load 16 source bytes from, and how to shuffle them
+  // (an index with the top bit set gives 0, which m_fill then fills in)
+  std::vector<std::uint16_t> m_offsets;
+  std::vector<std::array<byte_t, 16>> m_shuffles;
+  std::array<byte_t, 16> m_fill = {};
+  bool m_vectorized = false;
+
+  void ScaleRow(byte_t const* source, byte_t* out) const;
+};
+
+}  // namespace nes
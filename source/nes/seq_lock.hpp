@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// Publishes a small value from one writer thread to any number of readers without ever blocking
+// the writer. Readers retry if the writer was in the middle of an update; the value is held as
+// relaxed atomic words so that a torn read is merely discarded, never undefined.
+template <class T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock values must be trivially copyable");
+
+public:
+  // writer only
+  void Store(T const& value) {
+    std::array<std::uint64_t, word_count> words = {};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    auto sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto i = size_t{0}; i < word_count; ++i) {
+      m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+    m_sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  auto Load() const -> T {
+    std::array<std::uint64_t, word_count> words = {};
+    while (true) {
+      auto before = m_sequence.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      for (auto i = size_t{0}; i < word_count; ++i) {
+        words[i] = m_words[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (m_sequence.load(std::memory_order_relaxed) == before) break;
+    }
+
+    T value;
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    return value;
+  }
+
+private:
+  static constexpr size_t word_count = (sizeof(T) + 7) / 8;
+
+  std::atomic<std::uint64_t> m_sequence = 0;
+  std::array<std::atomic<std::uint64_t>, word_count> m_words = {};
+};
+
+}  // namespace nes
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "nes/common.hpp"
+
+// x86 vector kernels are compiled for their instruction set one function at a time, so the rest of
+// the build keeps its baseline target; callers check the host before calling them. Elsewhere only
+// the scalar versions exist.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RENES_SIMD_X86 1
+#define RENES_TARGET_SSSE3 __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RENES_SIMD_X86 1
+#define RENES_TARGET_SSSE3
+#endif
+
+// SSE2 is part of every x86-64 target (and of 32-bit ones that ask for it), so its kernels need no
+// host check
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RENES_SIMD_SSE2 1
+#endif
+
+namespace nes {
+
+#if defined(RENES_SIMD_X86)
+inline auto HostHasSsse3() -> bool {
+#if defined(__GNUC__)
+  static auto const has = __builtin_cpu_supports("ssse3") != 0;
+#else
+  static auto const has = [] {
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+  }();
+#endif
+  return has;
+}
+#else
+inline auto HostHasSsse3() -> bool { return false; }
+#endif
+
+}  // namespace nes
@@ -0,0 +1,56 @@
+#include "nes/snapshot.hpp"
+
+#include <fstream>
+
+namespace nes {
+
+SnapshotWriter::SnapshotWriter() : m_thread{&SnapshotWriter::WriteLoop, this} {}
+
+SnapshotWriter::~SnapshotWriter() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_stopping = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+auto SnapshotWriter::Read(string const& file, Snapshot& snapshot) -> bool {
+  auto in = std::ifstream{file, std::ios::binary};
+  if (!in) {
+    LOG_WARN("Could not read state file '" + file + '\'');
+    return false;
+  }
+
+  in.read(reinterpret_cast<char*>(&snapshot), sizeof(snapshot));
+  if (!in || !snapshot.Valid()) {
+    LOG_WARN("State file '" + file + "' is not compatible with this version of ReNES");
+    return false;
+  }
+
+  return true;
+}
+
+void SnapshotWriter::WriteLoop() {
+  auto lock = std::unique_lock{m_mutex};
+  while (true) {
+    m_cv.wait(lock, [this] { return m_has_pending || m_stopping; });
+    if (!m_has_pending && m_stopping) return;
+
+    std::swap(m_pending, m_writing);
+    auto file = std::move(m_pending_file);
+    m_has_pending = false;
+
+    lock.unlock();
+    auto out = std::ofstream{file, std::ios::binary};
+    out.write(reinterpret_cast<char const*>(m_writing.get()), sizeof(Snapshot));
+    if (out) {
+      LOG_DEBUG("Saved state to '" + file + '\'');
+    } else {
+      LOG_WARN("Could not write state file '" + file + '\'');
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace nes
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "nes/apu.hpp"
+#include "nes/bus.hpp"
+#include "nes/cartridge.hpp"
+#include "nes/common.hpp"
+#include "nes/cpu.hpp"
+#include "nes/ppu.hpp"
+
+namespace nes {
+
+// A complete copy of the console's state as one flat block, so that taking or restoring a
+// snapshot is a handful of memcpys. The layout is tied to the build that wrote it; `version` is
+// bumped whenever any of the component states change shape.
+struct Snapshot {
+  static constexpr std::uint32_t magic_value = 0x5353'4E52;  // "RNSS"
+  static constexpr std::uint32_t current_version = 5;
+
+  std::uint32_t magic = magic_value;
+  std::uint32_t version = current_version;
+  std::uint64_t size = sizeof(Snapshot);
+
+  std::uint64_t cycles = 0;
+  Cpu::State cpu = {};
+  Ppu::State ppu = {};
+  Apu::State apu = {};
+  Bus::State bus = {};
+  Cartridge::State cartridge = {};
+
+  auto Valid() const -> bool {
+    return magic == magic_value && version == current_version && size == sizeof(Snapshot);
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<Snapshot>);
+
+// Writes snapshots to disk on a background thread. Submitting copies the snapshot into a spare
+// buffer, so the caller never waits on the file system, and at most the latest pending snapshot
+// is kept if submissions outpace the disk.
+class SnapshotWriter {
+public:
+  SnapshotWriter();
+  SnapshotWriter(SnapshotWriter const&) = delete;
+  SnapshotWriter& operator=(SnapshotWriter const&) = delete;
+  ~SnapshotWriter();
+
+  // `fill` is called with the pending buffer while the writer's lock is held
+  template <class Fill>
+  void Submit(string const& file, Fill&& fill) {
+    {
+      std::lock_guard lock{m_mutex};
+      fill(*m_pending);
+      m_pending_file = file;
+      m_has_pending = true;
+    }
+    m_cv.notify_one();
+  }
+
+  static auto Read(string const& file, Snapshot& snapshot) -> bool;
+
+private:
+  std::unique_ptr<Snapshot> m_pending = std::make_unique<Snapshot>();
+  std::unique_ptr<Snapshot> m_writing = std::make_unique<Snapshot>();
+  string m_pending_file;
+  bool m_has_pending = false;
+  bool m_stopping = false;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::thread m_thread;
+
+  void WriteLoop();
+};
+
+}  // namespace nes
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include "nes/common.hpp"
+
+namespace nes {
+
+// A bounded queue for exactly one producer thread and one consumer thread. Neither side ever
+// blocks: Push fails when the queue is full and Pop fails when it is empty. Each side caches the
+// other's index and only reloads it when the cached value says the queue is full (or empty), and
+// the two indices live on separate cache lines, so in the common case the threads never contend.
+template <class T, size_t Capacity>
+class SpscQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "SpscQueue capacity must be a power of two");
+
+public:
+  // producer only
+  auto Push(T value) -> bool {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head_cache == Capacity) {
+      m_head_cache = m_head.load(std::memory_order_acquire);
+      if (tail - m_head_cache == Capacity) return false;
+    }
+
+    m_slots[tail & mask] = std::move(value);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  auto Pop(T& value) -> bool {
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail_cache) {
+      m_tail_cache = m_tail.load(std::memory_order_acquire);
+      if (head == m_tail_cache) return false;
+    }
+
+    value = std::move(m_slots[head & mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // either side; only a hint for the producer, since the consumer may pop at any time
+  auto Empty() const -> bool {
+    return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t mask = Capacity - 1;
+  static constexpr size_t cache_line = 64;
+
+  // consumer side
+  alignas(cache_line) std::atomic<size_t> m_head = 0;
+  size_t m_tail_cache = 0;
+
+  // producer side
+  alignas(cache_line) std::atomic<size_t> m_tail = 0;
+  size_t m_head_cache = 0;
+
+  alignas(cache_line) std::array<T, Capacity> m_slots = {};
+};
+
+}  // namespace nes
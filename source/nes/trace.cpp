@@ -0,0 +1,164 @@
+#include "nes/trace.hpp"
+
+#if defined(RENES_ENABLE_TRACING)
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nes/logger.hpp"
+
+namespace nes {
+
+namespace {
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<TraceRing>> rings;
+
+  // never destroyed, since threads may still record during static destruction
+  static auto Get() -> Registry& {
+    static auto* registry = new Registry{};
+    return *registry;
+  }
+};
+
+// how many Trace::Now() ticks make a microsecond
+auto TicksPerMicrosecond() -> double {
+#if defined(RENES_TRACE_TSC)
+  using Clock = std::chrono::steady_clock;
+  static auto const ticks = [] {
+    auto start = Clock::now();
+    auto start_ticks = Trace::Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    auto elapsed = std::chrono::duration<double, std::micro>{Clock::now() - start}.count();
+    return (Trace::Now() - start_ticks) / elapsed;
+  }();
+  return ticks;
+#else
+  return 1000.0;
+#endif
+}
+
+// zone names are literals in our own source, but keep the JSON valid whatever they hold
+void WriteString(std::ostream& out, char const* text) {
+  out << '"';
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\') out << '\\';
+    out << *text;
+  }
+  out << '"';
+}
+
+}  // namespace
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+void Trace::NameThread(char const* name) {
+  if (!t_ring) t_ring = Register();
+  t_ring->thread_name.store(name, std::memory_order_relaxed);
+}
+
+auto Trace::Dump(std::string const& file) -> bool {
+  struct Event {
+    char const* name;
+    std::uint64_t start;
+    std::uint64_t end;
+    std::size_t thread;
+  };
+
+  auto events = std::vector<Event>{};
+  auto threads = std::vector<std::pair<std::size_t, char const*>>{};
+  {
+    auto& registry = Registry::Get();
+    std::lock_guard lock{registry.mutex};
+    for (auto const& ring : registry.rings) {
+      threads.emplace_back(ring->Id(), ring->thread_name.load(std::memory_order_relaxed));
+
+      auto written = ring->Written();
+      auto first = written > TraceRing::capacity ? written - TraceRing::capacity : 0;
+      auto copied = events.size();
+      for (auto n = first; n < written; ++n) {
+        auto const& event = ring->At(n);
+        events.push_back({event.name.load(std::memory_order_relaxed),
+                          event.start.load(std::memory_order_relaxed),
+                          event.end.load(std::memory_order_relaxed), ring->Id()});
+      }
+
+      // drop anything the thread may have overwritten while we were copying
+      std::atomic_thread_fence(std::memory_order_acquire);
+      auto now_written = ring->Written();
+      auto overwritten = now_written - first >= TraceRing::capacity
+                             ? now_written - first - TraceRing::capacity + 1
+                             : 0;
+      auto drop = std::min<std::uint64_t>(overwritten, events.size() - copied);
+      events.erase(events.begin() + copied, events.begin() + copied + drop);
+    }
+  }
+
+  auto out = std::ofstream{file};
+  if (!out) {
+    LOG_WARN("Could not write trace file '" + file + '\'');
+    return false;
+  }
+
+  auto origin = std::uint64_t{0};
+  if (!events.empty()) {
+    origin = std::min_element(events.begin(), events.end(), [](auto& a, auto& b) {
+               return a.start < b.start;
+             })->start;
+  }
+  auto ticks_per_us = TicksPerMicrosecond();
+  auto Microseconds = [&](std::uint64_t ticks) { return ticks / ticks_per_us; };
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  auto first = true;
+  for (auto [id, name] : threads) {
+    if (!name) continue;
+    out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << id
+        << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    WriteString(out, name);
+    out << "}}";
+    first = false;
+  }
+
+  out.precision(3);
+  out << std::fixed;
+  for (auto const& event : events) {
+    out << (first ? "" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+        << ",\"ts\":" << Microseconds(event.start - origin)
+        << ",\"dur\":" << Microseconds(event.end - event.start) << ",\"name\":";
+    WriteString(out, event.name);
+    out << '}';
+    first = false;
+  }
+  out << "\n]}\n";
+
+  if (!out) {
+    LOG_WARN("Could not write trace file '" + file + '\'');
+    return false;
+  }
+  LOG_INFO("Wrote " + std::to_string(events.size()) + " trace events to '" + file + '\'');
+  return true;
+}
+
+// ----------------------------------------------
+// Private member function definitions
+// ----------------------------------------------
+
+auto Trace::Register() -> TraceRing* {
+  auto& registry = Registry::Get();
+  std::lock_guard lock{registry.mutex};
+  registry.rings.push_back(std::make_unique<TraceRing>(registry.rings.size()));
+  return registry.rings.back().get();
+}
+
+}  // namespace nes
+
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "nes/logger.hpp"
+
+#if defined(RENES_ENABLE_TRACING)
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RENES_TRACE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RENES_TRACE_TSC 1
+#else
+#include <chrono>
+#endif
+#endif
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+
+// Zones time the rest of the enclosing scope; names must be string literals. Without
+// RENES_ENABLE_TRACING they expand to nothing at all.
+#if defined(RENES_ENABLE_TRACING)
+#define TRACE_ZONE(name)   ::nes::TraceZone TRACE_CONCAT(trace_zone_, __LINE__){name}
+#define TRACE_THREAD(name) ::nes::Trace::NameThread(name)
+#else
+#define TRACE_ZONE(name)   static_cast<void>(0)
+#define TRACE_THREAD(name) static_cast<void>(0)
+#endif
+#define TRACE_DUMP(file) ::nes::Trace::Dump(file)
+
+namespace nes {
+
+#if !defined(RENES_ENABLE_TRACING)
+
+class Trace {
+public:
+  static auto Dump(std::string const&) -> bool {
+    LOG_WARN("This build records no trace; configure with RENES_ENABLE_TRACING=ON");
+    return false;
+  }
+};
+
+#else
+
+// The most recent zones a thread has finished, oldest overwritten first. Only the owning thread
+// writes; Trace::Dump reads from any thread and throws away whatever might have been overwritten
+// while it was reading.
+class TraceRing {
+public:
+  static constexpr std::size_t capacity = 1 << 16;
+
+  struct Event {
+    std::atomic<char const*> name = nullptr;
+    std::atomic<std::uint64_t> start = 0;
+    std::atomic<std::uint64_t> end = 0;
+  };
+
+  explicit TraceRing(std::size_t id) : m_id{id} {}
+
+  void Record(char const* name, std::uint64_t start, std::uint64_t end) {
+    auto n = m_written.load(std::memory_order_relaxed);
+    auto& event = m_events[n & (capacity - 1)];
+    // a reader that sees any of the stores below also sees m_written at n, so it knows the event
+    // that was in this slot is gone
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    m_written.store(n + 1, std::memory_order_release);
+  }
+
+  auto Id() const -> std::size_t { return m_id; }
+  auto Written() const -> std::uint64_t { return m_written.load(std::memory_order_acquire); }
+  auto At(std::uint64_t n) const -> Event const& { return m_events[n & (capacity - 1)]; }
+
+  std::atomic<char const*> thread_name = nullptr;
+
+private:
+  std::size_t m_id;
+  std::atomic<std::uint64_t> m_written = 0;
+  std::array<Event, capacity> m_events = {};
+};
+
+class Trace {
+public:
+  // TSC ticks where there is one, nanoseconds otherwise; Dump converts either to microseconds
+  static auto Now() -> std::uint64_t {
+#if defined(RENES_TRACE_TSC)
+    return __rdtsc();
+#else
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+#endif
+  }
+
+  static void Record(char const* name, std::uint64_t start, std::uint64_t end) {
+    if (!t_ring) t_ring = Register();
+    t_ring->Record(name, start, end);
+  }
+
+  static void NameThread(char const* name);
+
+  // Writes every thread's recorded zones to `file` as Chrome trace-event JSON, which Perfetto and
+  // chrome://tracing can open. Safe to call from any thread while the others keep recording.
+  static auto Dump(std::string const& file) -> bool;
+
+private:
+  inline static thread_local TraceRing* t_ring = nullptr;
+
+  static auto Register() -> TraceRing*;
+};
+
+class TraceZone {
+public:
+  explicit TraceZone(char const* name) : m_name{name}, m_start{Trace::Now()} {}
+  ~TraceZone() { Trace::Record(m_name, m_start, Trace::Now()); }
+
+  TraceZone(TraceZone const&) = delete;
+  auto operator=(TraceZone const&) -> TraceZone& = delete;
+
+private:
+  char const* m_name;
+  std::uint64_t m_start;
+};
+
+#endif
+
+}  // namespace nes
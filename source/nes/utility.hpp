@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <type_traits>
@@ -79,6 +80,25 @@ auto BitCast(From const& from) -> To {
   return to;
 }
 
+// 64-bit FNV-1a - cheap and good enough to tell ROM images apart
+constexpr auto Fnv1a(byte_t const* data, size_t size) -> std::uint64_t {
+  auto hash = std::uint64_t{0xCBF2'9CE4'8422'2325};
+  for (auto i = size_t{0}; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 0x0000'0100'0000'01B3;
+  }
+  return hash;
+}
+
+// The p-th quantile (0 to 1) of the `count` values from `first` on, by nearest rank rounding down.
+// Partially reorders the values.
+template <class It>
+auto Percentile(It first, size_t count, double p) -> double {
+  auto nth = first + static_cast<std::ptrdiff_t>(p * (count - 1));
+  std::nth_element(first, nth, first + count);
+  return *nth;
+}
+
 template <class T>
 constexpr auto AssumeNotNull(T* ptr) -> T* {
   assert(ptr != nullptr);
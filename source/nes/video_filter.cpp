@@ -0,0 +1,234 @@
+#include "nes/video_filter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "nes/simd.hpp"
+
+namespace nes {
+
+namespace {
+
+constexpr size_t border = 2;  // wide enough for the 5x5 neighbourhood 2xBR looks at
+
+// Copies a width x height image into `padded`, repeating its edge pixels `border` times outward so
+// the kernels can read every neighbour without checking where they are
+template <class Pixel>
+void Pad(size_t width, size_t height, Pixel pixel, std::vector<std::uint32_t>& padded) {
+  auto stride = width + 2 * border;
+  padded.resize(stride * (height + 2 * border));
+  for (auto y = size_t{0}; y < height + 2 * border; ++y) {
+    auto source_y = std::min(std::max(y, border) - border, height - 1);
+    auto* row = padded.data() + y * stride;
+    for (auto x = size_t{0}; x < width; ++x) row[border + x] = pixel(x, source_y);
+    std::fill(row, row + border, row[border]);
+    std::fill(row + border + width, row + stride, row[border + width - 1]);
+  }
+}
+
+// AdvMAME2x: each pixel becomes four, each taking the colour of the two neighbours it touches
+// when they match each other (and the pixel isn't in the middle of a straight line)
+void Scale2x(std::uint32_t const* padded, size_t width, size_t height, std::uint32_t* out) {
+  auto stride = width + 2 * border;
+  for (auto y = size_t{0}; y < height; ++y) {
+    auto const* e = padded + (y + border) * stride + border;
+    auto const* b = e - stride;
+    auto const* h = e + stride;
+    auto const* d = e - 1;
+    auto const* f = e + 1;
+    auto* top = out + 2 * y * 2 * width;
+    auto* bottom = top + 2 * width;
+
+    auto x = size_t{0};
+#if defined(RENES_SIMD_SSE2)
+    auto Load = [](std::uint32_t const* p) {
+      return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    };
+    auto Store = [](std::uint32_t* p, __m128i v) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    };
+    auto Select = [](__m128i mask, __m128i a, __m128i b) {
+      return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    };
+    for (; x < width - width % 4; x += 4) {
+      auto E = Load(e + x), B = Load(b + x), H = Load(h + x);
+      auto D = Load(d + x), F = Load(f + x);
+      auto straight = _mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F));
+      auto e0 = Select(_mm_andnot_si128(straight, _mm_cmpeq_epi32(D, B)), D, E);
+      auto e1 = Select(_mm_andnot_si128(straight, _mm_cmpeq_epi32(B, F)), F, E);
+      auto e2 = Select(_mm_andnot_si128(straight, _mm_cmpeq_epi32(D, H)), D, E);
+      auto e3 = Select(_mm_andnot_si128(straight, _mm_cmpeq_epi32(H, F)), F, E);
+      Store(top + 2 * x, _mm_unpacklo_epi32(e0, e1));
+      Store(top + 2 * x + 4, _mm_unpackhi_epi32(e0, e1));
+      Store(bottom + 2 * x, _mm_unpacklo_epi32(e2, e3));
+      Store(bottom + 2 * x + 4, _mm_unpackhi_epi32(e2, e3));
+    }
+#endif
+    for (; x < width; ++x) {
+      auto E = e[x], B = b[x], H = h[x], D = d[x], F = f[x];
+      auto corners = B != H && D != F;
+      top[2 * x + 0] = corners && D == B ? D : E;
+      top[2 * x + 1] = corners && B == F ? F : E;
+      bottom[2 * x + 0] = corners && D == H ? D : E;
+      bottom[2 * x + 1] = corners && H == F ? F : E;
+    }
+  }
+}
+
+// AdvMAME3x: as Scale2x, with the edge pixels between the corners following diagonal lines
+void Scale3x(std::uint32_t const* padded, size_t width, size_t height, std::uint32_t* out) {
+  auto stride = width + 2 * border;
+  auto out_stride = 3 * width;
+  for (auto y = size_t{0}; y < height; ++y) {
+    auto const* e = padded + (y + border) * stride + border;
+    auto const* b = e - stride;
+    auto const* h = e + stride;
+    auto* row0 = out + 3 * y * out_stride;
+    auto* row1 = row0 + out_stride;
+    auto* row2 = row1 + out_stride;
+
+    // one pixel left of each row, so that the 3x3 neighbourhood of x starts at x
+    auto const* above = b - 1;
+    auto const* middle = e - 1;
+    auto const* below = h - 1;
+
+    for (auto x = size_t{0}; x < width; ++x) {
+      auto A = above[x], B = above[x + 1], C = above[x + 2];
+      auto D = middle[x], E = middle[x + 1], F = middle[x + 2];
+      auto G = below[x], H = below[x + 1], I = below[x + 2];
+
+      std::fill(row0 + 3 * x, row0 + 3 * x + 3, E);
+      std::fill(row1 + 3 * x, row1 + 3 * x + 3, E);
+      std::fill(row2 + 3 * x, row2 + 3 * x + 3, E);
+      if (B == H || D == F) continue;
+
+      if (D == B) row0[3 * x + 0] = D;
+      if ((D == B && E != C) || (B == F && E != A)) row0[3 * x + 1] = B;
+      if (B == F) row0[3 * x + 2] = F;
+      if ((D == B && E != G) || (D == H && E != A)) row1[3 * x + 0] = D;
+      if ((B == F && E != I) || (H == F && E != C)) row1[3 * x + 2] = F;
+      if (D == H) row2[3 * x + 0] = D;
+      if ((D == H && E != I) || (H == F && E != G)) row2[3 * x + 1] = H;
+      if (H == F) row2[3 * x + 2] = F;
+    }
+  }
+}
+
+// YUV already multiplied by xBR's 48:7:6 channel weights, so a colour distance is a plain sum of
+// absolute differences
+auto ToYuv(std::uint32_t pixel) -> std::array<int, 3> {
+  auto r = static_cast<int>((pixel >> 16) & 0xFF);
+  auto g = static_cast<int>((pixel >> 8) & 0xFF);
+  auto b = static_cast<int>(pixel & 0xFF);
+  return {48 * (299 * r + 587 * g + 114 * b), 7 * (-169 * r - 331 * g + 500 * b),
+          6 * (500 * r - 419 * g - 81 * b)};
+}
+
+// xBR level 1 at 2x: every output pixel looks at the corner it sits in, weighs up whether an edge
+// runs across that corner or along the diagonal through it, and blends halfway towards the nearer
+// neighbour when the edge crosses the corner
+void Xbr2x(std::uint32_t const* padded, std::vector<std::array<int, 3>>& yuv, size_t width,
+           size_t height, std::uint32_t* out) {
+  auto stride = static_cast<std::ptrdiff_t>(width + 2 * border);
+  yuv.resize(stride * (height + 2 * border));
+  std::transform(padded, padded + yuv.size(), yuv.begin(), ToYuv);
+
+  auto Blend = [](std::uint32_t a, std::uint32_t b) {
+    return ((a & 0xFEFEFE) >> 1) + ((b & 0xFEFEFE) >> 1);
+  };
+
+  for (auto y = size_t{0}; y < height; ++y) {
+    for (auto x = size_t{0}; x < width; ++x) {
+      auto e = static_cast<std::ptrdiff_t>((y + border) * stride + border + x);
+
+      // the rule is written for the bottom right corner; mirroring it covers the other three
+      for (auto [dx, dy] : {std::pair{-1, -1}, {1, -1}, {-1, 1}, {1, 1}}) {
+        auto At = [&](int i, int j) { return e + i * dx + j * dy * stride; };
+        auto Distance = [&](std::ptrdiff_t p, std::ptrdiff_t q) {
+          return std::abs(yuv[p][0] - yuv[q][0]) + std::abs(yuv[p][1] - yuv[q][1]) +
+                 std::abs(yuv[p][2] - yuv[q][2]);
+        };
+
+        auto B = At(0, -1), C = At(1, -1), D = At(-1, 0), F = At(1, 0), G = At(-1, 1);
+        auto H = At(0, 1), I = At(1, 1), F4 = At(2, 0), I4 = At(2, 1), H5 = At(0, 2);
+        auto I5 = At(1, 2);
+
+        auto pixel = padded[e];
+        auto out_x = 2 * x + (dx > 0 ? 1 : 0);
+        auto out_y = 2 * y + (dy > 0 ? 1 : 0);
+        out[out_y * 2 * width + out_x] = pixel;
+
+        // no edge can cross a corner that continues the pixel's own colour
+        if (padded[e] == padded[F] || padded[e] == padded[H]) continue;
+
+        auto across = Distance(e, C) + Distance(e, G) + Distance(I, F4) + Distance(I, H5) +
+                      4 * Distance(H, F);
+        auto along = Distance(H, D) + Distance(H, I5) + Distance(F, I4) + Distance(F, B) +
+                     4 * Distance(e, I);
+
+        if (across < along) {
+          auto nearer = Distance(e, F) <= Distance(e, H) ? padded[F] : padded[H];
+          out[out_y * 2 * width + out_x] = Blend(pixel, nearer);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+auto ParseVideoFilter(std::string_view name) -> std::optional<VideoFilter> {
+  for (auto i = size_t{0}; i < video_filter_names.size(); ++i) {
+    if (name == video_filter_names[i]) return static_cast<VideoFilter>(i);
+  }
+  return std::nullopt;
+}
+
+// ----------------------------------------------
+// Public member function definitions
+// ----------------------------------------------
+
+void FrameFilter::Apply(VideoFilter filter, byte_t const* frame, std::vector<byte_t>& out) {
+  constexpr auto width = Display::Width();
+  constexpr auto height = Display::Height();
+
+  auto scale = GetFilterScale(filter);
+  out.resize(width * scale * height * scale * 3);
+  if (filter == VideoFilter::None) {
+    std::memcpy(out.data(), frame, out.size());
+    return;
+  }
+
+  Pad(width, height, [&](size_t x, size_t y) {
+    auto const* rgb = frame + 3 * (y * width + x);
+    return std::uint32_t{rgb[0]} << 16 | std::uint32_t{rgb[1]} << 8 | rgb[2];
+  }, m_padded);
+
+  m_scaled.resize(width * scale * height * scale);
+  auto const* result = m_scaled.data();
+  switch (filter) {
+  case VideoFilter::Scale2x: Scale2x(m_padded.data(), width, height, m_scaled.data()); break;
+  case VideoFilter::Scale3x: Scale3x(m_padded.data(), width, height, m_scaled.data()); break;
+  case VideoFilter::Scale4x: {
+    // AdvMAME4x is Scale2x applied twice
+    m_scaled_twice.resize(m_scaled.size());
+    Scale2x(m_padded.data(), width, height, m_scaled_twice.data());
+    Pad(2 * width, 2 * height, [&](size_t x, size_t y) {
+      return m_scaled_twice[y * 2 * width + x];
+    }, m_padded);
+    Scale2x(m_padded.data(), 2 * width, 2 * height, m_scaled.data());
+    break;
+  }
+  case VideoFilter::Xbr2x: Xbr2x(m_padded.data(), m_yuv, width, height, m_scaled.data()); break;
+  default: break;
+  }
+
+  for (auto i = size_t{0}; i < m_scaled.size(); ++i) {
+    out[3 * i + 0] = static_cast<byte_t>(result[i] >> 16);
+    out[3 * i + 1] = static_cast<byte_t>(result[i] >> 8);
+    out[3 * i + 2] = static_cast<byte_t>(result[i]);
+  }
+}
+
+}  // namespace nes
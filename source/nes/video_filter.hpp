@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "nes/common.hpp"
+#include "nes/display.hpp"
+
+namespace nes {
+
+// Pixel-art upscalers for Display frames. Scale2x/3x/4x are the AdvMAME rules, which only ever
+// copy existing colours; 2xBR is level 1 of Hyllian's xBR, which blends along the edges it finds.
+enum class VideoFilter : std::uint8_t { None, Scale2x, Scale3x, Scale4x, Xbr2x, Count };
+
+constexpr std::array<char const*, static_cast<size_t>(VideoFilter::Count)> video_filter_names = {
+    "none", "scale2x", "scale3x", "scale4x", "2xbr",
+};
+
+constexpr auto GetFilterScale(VideoFilter filter) -> uint {
+  switch (filter) {
+  case VideoFilter::Scale2x: return 2;
+  case VideoFilter::Scale3x: return 3;
+  case VideoFilter::Scale4x: return 4;
+  case VideoFilter::Xbr2x: return 2;
+  default: return 1;
+  }
+}
+
+auto ParseVideoFilter(std::string_view name) -> std::optional<VideoFilter>;
+
+// Holds the scratch buffers the filters work in, so that filtering one frame after another
+// allocates nothing once the buffers have grown to fit.
+class FrameFilter {
+public:
+  // Filters `frame` (a Display's raw pixel buffer) into `out` as packed RGB, GetFilterScale times
+  // the size of a Display in each direction.
+  void Apply(VideoFilter filter, byte_t const* frame, std::vector<byte_t>& out);
+
+private:
+  // 0x00RRGGBB, with a border of copied edge pixels around every side
+  std::vector<std::uint32_t> m_padded;
+  std::vector<std::uint32_t> m_scaled;
+  std::vector<std::uint32_t> m_scaled_twice;
+  std::vector<std::array<int, 3>> m_yuv;  // of m_padded, for 2xBR
+};
+
+}  // namespace nes
@@ -13,8 +13,14 @@ struct Options {
   bool print_help = false;
   nes::LogLevel log_level = nes::LogLevel::Info;
   std::string log_file = "";
+  std::string trace_file = "";
   std::string rom_file = "";
   std::optional<nes::addr_t> cpu_init_address = std::nullopt;
+  double speed = 1.0;
+  std::size_t rewind_budget = 0;
+  unsigned run_ahead = 0;
+  std::string record_file = "";
+  std::string replay_file = "";
 };
 
 void PrintHelp();
@@ -40,6 +46,8 @@ int main(int argc, char* argv[]) {
   gui_thread.join();
   nes_thread.join();
 
+  if (!options.trace_file.empty()) TRACE_DUMP(options.trace_file);
+
   return 0;
 }
 
@@ -48,16 +56,23 @@ int main(int argc, char* argv[]) {
 // ----------------------------------------------
 
 void RunGui(int argc, char* argv[], nes::Console* console) {
+  TRACE_THREAD("RunGui");
   auto app = new gui::Application{console};
   wxApp::SetInstance(app);
   wxEntry(argc, argv);
 }
 
 void RunNes(Options const& options, nes::Console* console) {
+  TRACE_THREAD("RunNes");
   LOG_INFO("Starting ReNES");
 
   console->Reset();
+  console->SetSpeed(options.speed);
+  console->EnableRewind(options.rewind_budget);
+  console->SetRunAhead(options.run_ahead);
   if (!options.rom_file.empty()) { console->Load(options.rom_file); }
+  if (!options.replay_file.empty()) { console->PlayMovie(options.replay_file); }
+  if (!options.record_file.empty()) { console->StartRecording(); }
 
   if (options.cpu_init_address.has_value()) {
     console->ForceCpuInitPc(*options.cpu_init_address);
@@ -68,6 +83,8 @@ void RunNes(Options const& options, nes::Console* console) {
   } catch (std::exception& e) {
     std::cerr << "ERROR: " << e.what() << "\n";
   }
+
+  if (!options.record_file.empty()) { console->StopRecording(options.record_file); }
 }
 
 Options ParseArgs(int argc, char* argv[]) {
@@ -124,8 +141,27 @@ Options ParseArgs(int argc, char* argv[]) {
         else if (arg == "none") LOG_LEVEL(None);
         else InvalidArgument(flag, arg);
         // clang-format on
+      } else if (flag == "--log-categories") {
+        if (auto mask = nes::ParseLogCategories(arg)) {
+          LOG_CATEGORIES(*mask);
+        } else {
+          InvalidArgument(flag, arg);
+        }
       } else if (flag == "--log-file") {
         options.log_file = arg;
+      } else if (flag == "--trace") {
+        options.trace_file = arg;
+      } else if (flag == "--speed") {
+        options.speed = std::stod(std::string{arg});
+        if (options.speed < 0.0) InvalidArgument(flag, arg);
+      } else if (flag == "--rewind") {
+        options.rewind_budget = std::stoul(std::string{arg}) << 20;
+      } else if (flag == "--record") {
+        options.record_file = arg;
+      } else if (flag == "--replay") {
+        options.replay_file = arg;
+      } else if (flag == "--run-ahead") {
+        options.run_ahead = std::stoul(std::string{arg});
       } else if (flag == "--force-cpu-init-pc") {
         auto pc = std::stoul(std::string{arg}, nullptr, 0);
         options.cpu_init_address = static_cast<nes::addr_t>(pc);
@@ -156,6 +192,26 @@ options:
       --log-level LEVEL   Sets the logging level to LEVEL. Can be one of:
                           'all', 'error', 'warn', 'info', 'debug', 'trace',
                           or 'none'.
+      --log-categories LIST
+                          Limits debug and trace messages to the listed
+                          subsystems, separated by commas. Can include
+                          'cpu', 'ppu', 'bus', 'gui', or 'all' (default).
+      --trace FILE        Writes a timeline of the run to FILE on exit, in
+                          Chrome trace-event format (for Perfetto or
+                          chrome://tracing). Pressing F4 writes one to
+                          renes-trace.json at any time. Needs a build
+                          configured with RENES_ENABLE_TRACING=ON.
+      --speed MULTIPLIER  Runs emulation at MULTIPLIER times the speed of an
+                          NTSC console (default 1). Use 0 to run uncapped.
+      --rewind MIB        Keeps up to MIB mebibytes of per-frame history so
+                          that emulation can be rewound by holding
+                          Backspace (default 0, off).
+      --record FILE       Records every frame's input as a movie, written to
+                          FILE on exit.
+      --replay FILE       Replays the movie in FILE after loading the rom.
+      --run-ahead N       Emulates N frames ahead of every displayed frame to
+                          hide input latency (default 0, off). The cost per
+                          frame is logged at the 'debug' level.
       --force-cpu-init-pc ADDRESS
                           Forces the CPU to start execution at ADDRESS. You
                           probably don't need to use this!
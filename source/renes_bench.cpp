@@ -0,0 +1,631 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "nes/nes.hpp"
+
+using nes::byte_t;
+
+struct Options {
+  bool print_help = false;
+  int warmup = 2;
+  int repetitions = 10;
+  double threshold = 5.0;  // percent
+  bool counters = false;
+  std::string filter = "";
+  std::string json_file = "";
+  std::string baseline_file = "";
+  std::vector<std::string> rom_files = {};
+};
+
+// a single timed run: how long it took and how many units of work (instructions, dots, frames)
+// were completed in that time, plus the host CPU's counters over the run when --counters is on
+struct Sample {
+  double ns = 0.0;
+  double units = 0.0;
+  nes::HwCounts host = {};
+};
+
+struct Benchmark {
+  std::string name;
+  std::string unit;
+  bool per_second = false;  // report units/sec (higher is better) instead of ns/unit
+  std::function<Sample()> run;
+};
+
+struct Result {
+  std::string name;
+  std::string unit;
+  bool per_second = false;
+  double mean = 0.0;
+  double stddev = 0.0;
+  double min = 0.0;
+  double median = 0.0;
+  int repetitions = 0;
+
+  // over every measured repetition; misses are per thousand units
+  bool host_counters = false;
+  double ipc = 0.0;
+  double cache_misses = 0.0;
+  double branch_misses = 0.0;
+};
+
+void PrintHelp();
+Options ParseArgs(int argc, char* argv[]);
+
+auto HostCounters() -> nes::HwCounters&;
+auto MakeBenchmarks(Options const& options) -> std::vector<Benchmark>;
+auto RunBenchmark(Benchmark const& benchmark, Options const& options) -> Result;
+auto UnitName(Result const& result) -> std::string;
+void WriteJson(std::ostream& out, std::vector<Result> const& results);
+auto ReadBaseline(std::string const& file) -> std::map<std::string, double>;
+auto CompareToBaseline(std::vector<Result> const& results, Options const& options,
+                       std::ostream& report) -> bool;
+
+int main(int argc, char* argv[]) {
+  auto options = ParseArgs(argc, argv);
+  if (options.print_help) {
+    PrintHelp();
+    return 0;
+  }
+
+  // opened before quieting the log, so that it can say why the counters are unavailable
+  if (options.counters) HostCounters().Open();
+  LOG_LEVEL(Warn);
+
+#if !defined(NDEBUG)
+  std::cerr << "WARNING: renes-bench was built without optimizations (NDEBUG is not defined)\n";
+#endif
+
+  // opened up front, so that a bad path fails before the benchmarks take their time
+  auto json_file = std::ofstream{};
+  if (!options.json_file.empty() && options.json_file != "-") {
+    json_file.open(options.json_file);
+    if (!json_file) {
+      std::cerr << "ERROR: Could not open '" << options.json_file << "' for writing\n";
+      return 1;
+    }
+  }
+  // JSON on standard output keeps it to itself
+  auto& report = options.json_file == "-" ? std::cerr : std::cout;
+
+  auto results = std::vector<Result>{};
+  try {
+    for (auto const& benchmark : MakeBenchmarks(options)) {
+      if (benchmark.name.find(options.filter) == std::string::npos) continue;
+      results.push_back(RunBenchmark(benchmark, options));
+
+      auto const& r = results.back();
+      report << std::left << std::setw(28) << r.name << std::right << std::fixed
+             << std::setprecision(3) << std::setw(14) << r.mean << ' ' << std::left
+             << std::setw(16) << r.unit << std::right << " +/- " << std::setw(6)
+             << std::setprecision(2) << (r.mean != 0.0 ? 100.0 * r.stddev / r.mean : 0.0)
+             << "%  (min " << std::setprecision(3) << r.min << ", median " << r.median
+             << ", n = " << r.repetitions << ")\n";
+      if (r.host_counters) {
+        report << "  host ipc " << std::setprecision(2) << r.ipc << ", " << std::setprecision(3)
+               << r.cache_misses << " cache misses and " << r.branch_misses
+               << " branch misses per 1k " << UnitName(r) << "s\n";
+      }
+    }
+  } catch (std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (options.json_file == "-") {
+    WriteJson(std::cout, results);
+  } else if (json_file.is_open()) {
+    WriteJson(json_file, results);
+    json_file.close();
+    if (!json_file) {
+      std::cerr << "ERROR: Could not write '" << options.json_file << "'\n";
+      return 1;
+    }
+  }
+
+  if (!options.baseline_file.empty() && !CompareToBaseline(results, options, report)) return 1;
+  return 0;
+}
+
+// ----------------------------------------------
+// Bundled workloads
+// ----------------------------------------------
+
+// Builds a 16 KiB NROM image with `program` at $C000, `nmi` at $C100 and a blank-ish CHR ROM
+auto MakeNrom(std::vector<byte_t> const& program, std::vector<byte_t> const& nmi) {
+  auto rom = std::vector<byte_t>{'N', 'E', 'S', 0x1A, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+  auto prg = std::vector<byte_t>(0x4000, 0xEA);  // NOP
+  std::copy(program.begin(), program.end(), prg.begin());
+  std::copy(nmi.begin(), nmi.end(), prg.begin() + 0x0100);
+  prg[0x3FFA] = 0x00, prg[0x3FFB] = 0xC1;  // NMI   -> $C100
+  prg[0x3FFC] = 0x00, prg[0x3FFD] = 0xC0;  // RESET -> $C000
+  prg[0x3FFE] = 0x00, prg[0x3FFF] = 0xC1;  // IRQ   -> $C100
+  rom.insert(rom.end(), prg.begin(), prg.end());
+
+  for (auto i = 0u; i < 0x2000; ++i) rom.push_back(static_cast<byte_t>(i * 37));
+  return rom;
+}
+
+// A loop mixing loads/stores across addressing modes, arithmetic, shifts, stack use, subroutine
+// calls and branches - roughly the shape of typical game logic
+auto InstructionMixRom() {
+  // clang-format off
+  return MakeNrom({
+      0xA2, 0x00,        // $C000  LDX #$00
+      0xA0, 0x10,        // $C002  LDY #$10
+      0xA9, 0x37,        // $C004  LDA #$37
+      0x69, 0x11,        // $C006  ADC #$11
+      0x95, 0x00,        // $C008  STA $00,X
+      0xB5, 0x00,        // $C00A  LDA $00,X
+      0x0A,              // $C00C  ASL A
+      0x26, 0x01,        // $C00D  ROL $01
+      0x48,              // $C00F  PHA
+      0x68,              // $C010  PLA
+      0x20, 0x30, 0xC0,  // $C011  JSR $C030
+      0xE8,              // $C014  INX
+      0x9D, 0x00, 0x02,  // $C015  STA $0200,X
+      0xBD, 0x00, 0x02,  // $C018  LDA $0200,X
+      0xC9, 0x80,        // $C01B  CMP #$80
+      0x88,              // $C01D  DEY
+      0xD0, 0xE4,        // $C01E  BNE $C004
+      0xA0, 0x10,        // $C020  LDY #$10
+      0x4C, 0x04, 0xC0,  // $C022  JMP $C004
+      0xEA, 0xEA, 0xEA, 0xEA, 0xEA, 0xEA, 0xEA, 0xEA, 0xEA,
+      0xEA, 0xEA,        // $C025  (padding)
+      0x45, 0x02,        // $C030  EOR $02
+      0x85, 0x02,        // $C032  STA $02
+      0x60,              // $C034  RTS
+  }, {0x40});            // $C100  RTI
+  // clang-format on
+}
+
+// Fills a nametable and the palettes, turns on rendering and NMIs, then spins in a main loop while
+// the NMI handler scrolls the background
+auto RenderingRom() {
+  // clang-format off
+  return MakeNrom({
+      0x78,              // $C000  SEI
+      0xA9, 0x20,        // $C001  LDA #$20
+      0x8D, 0x06, 0x20,  // $C003  STA $2006
+      0xA9, 0x00,        // $C006  LDA #$00
+      0x8D, 0x06, 0x20,  // $C008  STA $2006
+      0xA2, 0x00,        // $C00B  LDX #$00
+      0xA0, 0x04,        // $C00D  LDY #$04
+      0x8E, 0x07, 0x20,  // $C00F  STX $2007
+      0xE8,              // $C012  INX
+      0xD0, 0xFA,        // $C013  BNE $C00F
+      0x88,              // $C015  DEY
+      0xD0, 0xF7,        // $C016  BNE $C00F
+      0xA9, 0x3F,        // $C018  LDA #$3F
+      0x8D, 0x06, 0x20,  // $C01A  STA $2006
+      0xA9, 0x00,        // $C01D  LDA #$00
+      0x8D, 0x06, 0x20,  // $C01F  STA $2006
+      0xA2, 0x00,        // $C022  LDX #$00
+      0x8E, 0x07, 0x20,  // $C024  STX $2007
+      0xE8,              // $C027  INX
+      0xE0, 0x20,        // $C028  CPX #$20
+      0xD0, 0xF8,        // $C02A  BNE $C024
+      0xA9, 0x90,        // $C02C  LDA #$90
+      0x8D, 0x00, 0x20,  // $C02E  STA $2000
+      0xA9, 0x1E,        // $C031  LDA #$1E
+      0x8D, 0x01, 0x20,  // $C033  STA $2001
+      0xE6, 0x00,        // $C036  INC $00
+      0xA5, 0x00,        // $C038  LDA $00
+      0x65, 0x01,        // $C03A  ADC $01
+      0x85, 0x01,        // $C03C  STA $01
+      0x4C, 0x36, 0xC0,  // $C03E  JMP $C036
+  }, {
+      0x48,              // $C100  PHA
+      0xE6, 0x02,        // $C101  INC $02
+      0xA5, 0x02,        // $C103  LDA $02
+      0x8D, 0x05, 0x20,  // $C105  STA $2005
+      0xA9, 0x00,        // $C108  LDA #$00
+      0x8D, 0x05, 0x20,  // $C10A  STA $2005
+      0x68,              // $C10D  PLA
+      0x40,              // $C10E  RTI
+  });
+  // clang-format on
+}
+
+// Bare components wired together like a Console, so the CPU or PPU can be stepped on its own
+struct Rig {
+  nes::Apu apu = {};
+  nes::Bus bus = {};
+  nes::Cpu cpu = {};
+  nes::Ppu ppu = {};
+  nes::Cartridge cartridge = {};
+  nes::Display display = {};
+
+  explicit Rig(std::vector<byte_t> const& rom) {
+    bus.AttachApu(&apu);
+    bus.AttachCpu(&cpu);
+    bus.AttachPpu(&ppu);
+    bus.AttachCartridge(&cartridge);
+    apu.AttachBus(&bus);
+    cpu.AttachBus(&bus);
+    ppu.AttachBus(&bus);
+    ppu.AttachCartridge(&cartridge);
+    ppu.AttachDisplay(&display);
+
+    if (!cartridge.Load("bench", rom)) throw std::runtime_error("Could not load bench ROM");
+    cpu.Reset();
+  }
+};
+
+auto HostCounters() -> nes::HwCounters& {
+  static auto counters = nes::HwCounters{};
+  return counters;
+}
+
+// times `function`, leaving the caller to fill in how many units of work it did
+template <class Function>
+auto Time(Function&& function) -> Sample {
+  auto host = HostCounters().Read();
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double, std::nano>{end - start}.count(), 0.0,
+          HostCounters().Read() - host};
+}
+
+auto CpuInstructionMix() -> Sample {
+  constexpr auto cycles = 2'000'000;
+
+  auto rig = std::make_unique<Rig>(InstructionMixRom());
+  auto before = rig->cpu.GetInstructionCount();
+  auto sample = Time([&] {
+    for (auto i = 0; i < cycles; ++i) rig->cpu.Step();
+  });
+  sample.units = static_cast<double>(rig->cpu.GetInstructionCount() - before);
+  return sample;
+}
+
+auto PpuFrame() -> Sample {
+  constexpr auto frames = 30;
+
+  // the same setup RenderingRom performs, written straight to the PPU registers
+  auto rig = std::make_unique<Rig>(RenderingRom());
+  auto& bus = rig->bus;
+  bus.Write(nes::locations::ppu_addr, 0x20);
+  bus.Write(nes::locations::ppu_addr, 0x00);
+  for (auto i = 0u; i < 0x0400; ++i) bus.Write(nes::locations::ppu_data, static_cast<byte_t>(i));
+  bus.Write(nes::locations::ppu_addr, 0x3F);
+  bus.Write(nes::locations::ppu_addr, 0x00);
+  for (auto i = 0u; i < 0x20; ++i) bus.Write(nes::locations::ppu_data, static_cast<byte_t>(i));
+  bus.Write(nes::locations::ppu_ctrl, 0x10);
+  bus.Write(nes::locations::ppu_mask, 0x1E);
+
+  auto dots = std::uint64_t{0};
+  auto& ppu = rig->ppu;
+  auto sample = Time([&] {
+    auto end = ppu.FrameCount() + frames;
+    while (ppu.FrameCount() != end) {
+      ppu.Step();
+      ++dots;
+    }
+  });
+  sample.units = static_cast<double>(dots);
+  return sample;
+}
+
+auto ApuFrame() -> Sample {
+  constexpr auto frames = 60;
+  constexpr auto cycles_per_frame = 29'781;
+
+  // all four tone channels playing, so every channel's synthesis path is exercised
+  auto rig = std::make_unique<Rig>(InstructionMixRom());
+  auto& bus = rig->bus;
+  bus.Write(nes::locations::sound_channel, 0x0F);
+  bus.Write(nes::locations::frame_counter, 0x40);
+  bus.Write(nes::locations::sq1_vol, 0xBF);
+  bus.Write(nes::locations::sq1_lo, 0xFD);
+  bus.Write(nes::locations::sq1_hi, 0x08);
+  bus.Write(nes::locations::sq2_vol, 0x7F);
+  bus.Write(nes::locations::sq2_lo, 0x7E);
+  bus.Write(nes::locations::sq2_hi, 0x08);
+  bus.Write(nes::locations::tri_linear, 0xFF);
+  bus.Write(nes::locations::tri_lo, 0x7E);
+  bus.Write(nes::locations::tri_hi, 0x08);
+  bus.Write(nes::locations::noise_vol, 0x3F);
+  bus.Write(nes::locations::noise_lo, 0x04);
+  bus.Write(nes::locations::noise_hi, 0x08);
+
+  auto ring = nes::SampleRing{1 << 10};
+  auto samples = std::array<std::int16_t, 1 << 10>{};
+  auto& apu = rig->apu;
+  auto sample = Time([&] {
+    for (auto i = 0; i < frames; ++i) {
+      for (auto c = 0; c < cycles_per_frame; ++c) apu.Tick();
+      apu.EndFrame(ring);
+      ring.Read(samples.data(), samples.size());
+    }
+  });
+  sample.units = static_cast<double>(frames) * cycles_per_frame;
+  return sample;
+}
+
+auto ConsoleFrames(std::string const& name, std::vector<byte_t> const& rom) -> Sample {
+  constexpr auto frames = 60;
+
+  auto console = std::make_unique<nes::Console>();
+  console->Reset();
+  console->SetSpeed(0.0);
+  console->Load(name, rom);
+  if (!console->GetCartridge().Valid()) throw std::runtime_error("Could not load " + name);
+
+  auto sample = Time([&] {
+    for (auto i = 0; i < frames; ++i) console->StepFrame();
+  });
+  sample.units = static_cast<double>(frames);
+  return sample;
+}
+
+auto MakeBenchmarks(Options const& options) -> std::vector<Benchmark> {
+  auto benchmarks = std::vector<Benchmark>{
+      {"cpu/instruction-mix", "ns/instruction", false, CpuInstructionMix},
+      {"ppu/frame", "ns/dot", false, PpuFrame},
+      {"apu/frame", "ns/cycle", false, ApuFrame},
+      {"console/rendering", "frames/sec", true,
+       [] { return ConsoleFrames("rendering", RenderingRom()); }},
+  };
+
+  for (auto const& file : options.rom_files) {
+    auto in = std::ifstream{file, std::ios::binary};
+    if (!in) throw std::runtime_error("Could not read '" + file + '\'');
+    auto rom = std::vector<byte_t>(std::istreambuf_iterator<char>(in), {});
+    auto name = std::filesystem::path{file}.stem().string();
+    benchmarks.push_back({"console/" + name, "frames/sec", true,
+                          [name, rom] { return ConsoleFrames(name, rom); }});
+  }
+
+  return benchmarks;
+}
+
+// ----------------------------------------------
+// Statistics and reporting
+// ----------------------------------------------
+
+auto RunBenchmark(Benchmark const& benchmark, Options const& options) -> Result {
+  for (auto i = 0; i < options.warmup; ++i) benchmark.run();
+
+  auto values = std::vector<double>{};
+  auto host = nes::HwCounts{};
+  auto units = 0.0;
+  for (auto i = 0; i < options.repetitions; ++i) {
+    auto sample = benchmark.run();
+    values.push_back(benchmark.per_second ? sample.units / (sample.ns * 1e-9)
+                                          : sample.ns / sample.units);
+    host.cycles += sample.host.cycles;
+    host.instructions += sample.host.instructions;
+    host.cache_misses += sample.host.cache_misses;
+    host.branch_misses += sample.host.branch_misses;
+    units += sample.units;
+  }
+
+  auto result = Result{benchmark.name, benchmark.unit, benchmark.per_second};
+  result.repetitions = static_cast<int>(values.size());
+  if (values.empty()) return result;
+
+  if (HostCounters().IsOpen() && units > 0.0) {
+    result.host_counters = true;
+    result.ipc = host.Ipc();
+    result.cache_misses = 1000.0 * host.cache_misses / units;
+    result.branch_misses = 1000.0 * host.branch_misses / units;
+  }
+
+  auto n = static_cast<double>(values.size());
+  for (auto v : values) result.mean += v / n;
+  for (auto v : values) result.stddev += (v - result.mean) * (v - result.mean);
+  result.stddev = values.size() > 1 ? std::sqrt(result.stddev / (n - 1)) : 0.0;
+
+  std::sort(values.begin(), values.end());
+  result.min = values.front();
+  result.median = values[values.size() / 2];
+  return result;
+}
+
+// what one unit of work is: "instruction" for ns/instruction, "frame" for frames/sec
+auto UnitName(Result const& result) -> std::string {
+  auto slash = result.unit.find('/');
+  if (!result.per_second) return result.unit.substr(slash + 1);
+
+  auto name = result.unit.substr(0, slash);
+  if (!name.empty() && name.back() == 's') name.pop_back();
+  return name;
+}
+
+void WriteJson(std::ostream& out, std::vector<Result> const& results) {
+  out << "{\n  \"benchmarks\": [\n";
+  for (auto i = 0u; i < results.size(); ++i) {
+    auto const& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+        << "\", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev << ", \"min\": " << r.min
+        << ", \"median\": " << r.median << ", \"repetitions\": " << r.repetitions;
+    if (r.host_counters) {
+      out << ", \"ipc\": " << r.ipc << ", \"cache_misses_per_1k\": " << r.cache_misses
+          << ", \"branch_misses_per_1k\": " << r.branch_misses;
+    }
+    out << '}' << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+}
+
+// Reads back the mean of each benchmark from a file written by WriteJson. This isn't a general
+// JSON parser - it relies on each benchmark being written on its own line.
+auto ReadBaseline(std::string const& file) -> std::map<std::string, double> {
+  auto in = std::ifstream{file};
+  if (!in) throw std::runtime_error("Could not read baseline '" + file + '\'');
+
+  auto FieldValue = [](std::string const& line, std::string_view field) -> std::string {
+    auto key = "\"" + std::string{field} + "\": ";
+    auto pos = line.find(key);
+    if (pos == std::string::npos) return {};
+    pos += key.size();
+    if (line[pos] == '"') {
+      return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+    } else {
+      return line.substr(pos, line.find_first_of(",}", pos) - pos);
+    }
+  };
+
+  auto baseline = std::map<std::string, double>{};
+  for (std::string line; std::getline(in, line);) {
+    auto name = FieldValue(line, "name");
+    auto mean = FieldValue(line, "mean");
+    if (!name.empty() && !mean.empty()) baseline[name] = std::stod(mean);
+  }
+  return baseline;
+}
+
+auto CompareToBaseline(std::vector<Result> const& results, Options const& options,
+                       std::ostream& report) -> bool {
+  auto baseline = ReadBaseline(options.baseline_file);
+
+  auto passed = true;
+  report << "\nComparison against '" << options.baseline_file << "' (threshold "
+         << options.threshold << "%):\n";
+  for (auto const& r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end() || it->second == 0.0) {
+      report << "  " << std::left << std::setw(28) << r.name << "no baseline\n";
+      continue;
+    }
+
+    // positive change always means "slower", whichever direction the unit runs in
+    auto change = 100.0 * (r.mean - it->second) / it->second;
+    if (r.per_second) change = -change;
+
+    auto regressed = change > options.threshold;
+    passed &= !regressed;
+    report << "  " << std::left << std::setw(28) << r.name << std::right << std::showpos
+           << std::setprecision(2) << std::setw(8) << change << std::noshowpos << "% "
+           << (regressed ? "REGRESSION" : (change < -options.threshold ? "improved" : "ok"))
+           << '\n';
+  }
+
+  return passed;
+}
+
+// ----------------------------------------------
+// Argument parsing
+// ----------------------------------------------
+
+Options ParseArgs(int argc, char* argv[]) {
+  using namespace std::literals;
+
+  auto options = Options{};
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  auto IsFlag = [](auto it) { return it.front() == '-' && it.size() > 1; };
+
+  auto InvalidArgument = [&](std::string_view flag, std::string_view arg = ""sv) mutable {
+    options.print_help = true;
+    std::cerr << "Invalid argument to '" << flag;
+    if (arg.empty()) {
+      std::cerr << "'\n";
+      return;
+    } else {
+      std::cerr << "' : '" << arg << "'\n";
+    }
+  };
+
+  auto GetArgument = [&](auto flag, auto it) {
+    if (it == args.end() || IsFlag(*it)) {
+      options.print_help = true;
+      InvalidArgument(flag);
+      return ""sv;
+    }
+    return *it;
+  };
+
+  auto UnknownFlag = [&](std::string_view flag) mutable {
+    options.print_help = true;
+    std::cerr << "Unknown flag '" << flag << "'\n";
+  };
+
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (auto flag = *it; IsFlag(flag)) {
+      if (flag == "-h" || flag == "--help") {
+        options.print_help = true;
+        return options;
+      }
+      if (flag == "--counters") {
+        options.counters = true;
+        continue;
+      }
+
+      auto arg = GetArgument(flag, ++it);
+      if (arg.empty()) return options;
+
+      if (flag == "--warmup") {
+        options.warmup = std::stoi(std::string{arg});
+      } else if (flag == "--repetitions") {
+        options.repetitions = std::stoi(std::string{arg});
+        if (options.repetitions < 1) InvalidArgument(flag, arg);
+      } else if (flag == "--filter") {
+        options.filter = arg;
+      } else if (flag == "--json") {
+        options.json_file = arg;
+      } else if (flag == "--baseline") {
+        options.baseline_file = arg;
+      } else if (flag == "--threshold") {
+        options.threshold = std::stod(std::string{arg});
+      } else if (flag == "--rom") {
+        options.rom_files.emplace_back(arg);
+      } else {
+        UnknownFlag(flag);
+        return options;
+      }
+    } else /* !IsFlag(it) */ {
+      std::cerr << *it << " is not a valid position argument\n";
+      options.print_help = true;
+      return options;
+    }
+  }
+  return options;
+}
+
+void PrintHelp() {
+  constexpr auto help = R"EOF(
+usage: renes-bench [options]
+
+Runs the CPU, PPU and whole-console benchmarks on built-in workloads.
+
+options:
+  -h, --help              Prints this help message and exits.
+      --warmup N          Runs each benchmark N times before measuring
+                          (default 2).
+      --repetitions N     Measures each benchmark N times (default 10).
+      --filter TEXT       Only runs benchmarks whose name contains TEXT.
+      --rom FILE          Adds a whole-console benchmark running FILE. May be
+                          given more than once.
+      --json FILE         Writes results as JSON to FILE ('-' for stdout, which
+                          moves the results table to stderr).
+      --baseline FILE     Compares results against a JSON file written by
+                          --json, and exits with status 1 if any benchmark
+                          is slower by more than the threshold.
+      --threshold PCT     Regression threshold in percent (default 5).
+      --counters          Also reports the host CPU's IPC, cache misses and
+                          branch misses for each benchmark, read through
+                          Linux's perf_event_open. The cpu/ and ppu/
+                          benchmarks step only that component, so their
+                          counters belong to it alone.
+
+)EOF";
+
+  std::cout << help;
+}
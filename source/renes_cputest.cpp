@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "nes/cpu.hpp"
+#include "nes/flat_bus.hpp"
+#include "nes/opinfo.hpp"
+#include "nes/utility.hpp"
+
+using nes::addr_t;
+using nes::byte_t;
+
+struct Options {
+  bool print_help = false;
+  bool verbose = false;
+  bool unofficial = false;
+  unsigned jobs = 0;  // 0 for one per hardware thread
+  size_t shown_failures = 3;
+  std::vector<std::string> paths = {};
+};
+
+// The per-opcode single-step vectors (SingleStepTests' nes6502 set, and the older ProcessorTests
+// files before it) come as one JSON file per opcode, each an array of cases:
+//
+//   {"name": "a9 12 34", "initial": {"pc": .., "s": .., "a": .., "x": .., "y": .., "p": ..,
+//    "ram": [[addr, value], ...]}, "final": {...}, "cycles": [[addr, value, "read"], ...]}
+//
+// Every address the instruction touches is in both RAM lists, and "cycles" lists one bus access
+// per clock cycle.
+struct Snapshot {
+  nes::Cpu::Registers reg = {};
+  std::vector<std::pair<addr_t, byte_t>> ram = {};
+};
+
+struct Case {
+  std::string name;
+  Snapshot initial;
+  Snapshot final;
+  size_t cycles = 0;
+};
+
+struct OpcodeFile {
+  std::string name;  // relative to the directory it was found in
+  std::filesystem::path file;
+  int opcode = -1;  // from the file name, when it has one
+};
+
+struct Result {
+  enum class Kind { Pass, Fail, Skipped, Error };
+
+  Kind kind = Kind::Pass;
+  std::uint64_t passed = 0;
+  std::uint64_t failed = 0;
+  std::vector<std::string> failures = {};  // the first few, described
+  std::string error = "";
+  double host_seconds = 0.0;
+};
+
+// Pulls values out of a JSON file a buffer at a time, so a file of any size is read in constant
+// memory and no document tree is ever built. Only as much of JSON as the test vectors use is
+// understood: objects, arrays, strings and integers, with anything else skipped over.
+class JsonReader {
+public:
+  static constexpr size_t buffer_size = 1 << 20;
+
+  explicit JsonReader(std::FILE* file) : m_file{file}, m_buffer(buffer_size) {}
+
+  // the next character that isn't whitespace, without consuming it; '\0' at the end of the file
+  auto Peek() -> char {
+    for (;;) {
+      if (m_pos == m_end && !Refill()) return '\0';
+      auto c = m_buffer[m_pos];
+      if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return c;
+      ++m_pos;
+    }
+  }
+
+  auto Consume(char c) -> bool {
+    if (Peek() != c) return false;
+    ++m_pos;
+    return true;
+  }
+
+  void Expect(char c) {
+    if (!Consume(c)) Fail(std::string{"expected '"} + c + "'");
+  }
+
+  void ReadString(std::string& out);
+  auto ReadInt() -> long long;
+  void Skip();
+
+  // calls visit(key) with the reader positioned at each member's value, which visit must consume
+  template <class F>
+  void ForEachMember(F visit) {
+    Expect('{');
+    if (Consume('}')) return;
+    auto key = std::string{};
+    do {
+      ReadString(key);
+      Expect(':');
+      visit(std::string_view{key});
+    } while (Consume(','));
+    Expect('}');
+  }
+
+  // calls visit() with the reader positioned at each element, which visit must consume
+  template <class F>
+  void ForEachElement(F visit) {
+    Expect('[');
+    if (Consume(']')) return;
+    do {
+      visit();
+    } while (Consume(','));
+    Expect(']');
+  }
+
+private:
+  std::FILE* m_file;
+  std::vector<char> m_buffer;
+  size_t m_pos = 0;
+  size_t m_end = 0;
+  std::uint64_t m_offset = 0;  // of the start of the buffer in the file
+  std::string m_skipped = "";
+
+  auto Refill() -> bool {
+    m_offset += m_end;
+    m_end = std::fread(m_buffer.data(), 1, m_buffer.size(), m_file);
+    m_pos = 0;
+    return m_end != 0;
+  }
+
+  // the next character exactly as it is, whitespace included
+  auto Get() -> char {
+    if (m_pos == m_end && !Refill()) Fail("unexpected end of file");
+    return m_buffer[m_pos++];
+  }
+
+  [[noreturn]] void Fail(std::string const& what) {
+    throw std::runtime_error(what + " at byte " + std::to_string(m_offset + m_pos));
+  }
+};
+
+void PrintHelp();
+Options ParseArgs(int argc, char* argv[]);
+
+auto FindFiles(Options const& options) -> std::vector<OpcodeFile>;
+auto RunFile(OpcodeFile const& file, Options const& options) -> Result;
+void ReadCase(JsonReader& json, Case& test);
+auto RunCase(nes::Cpu& cpu, nes::FlatBus& bus, Case const& test) -> std::string;
+auto Describe(Result const& result) -> std::string;
+
+int main(int argc, char* argv[]) {
+  auto options = ParseArgs(argc, argv);
+  if (options.print_help || options.paths.empty()) {
+    PrintHelp();
+    return options.print_help ? 0 : 1;
+  }
+  LOG_LEVEL(Warn);
+
+#if !defined(NDEBUG)
+  std::cerr << "WARNING: renes-cputest was built without optimizations (NDEBUG is not defined)\n";
+#endif
+
+  auto files = FindFiles(options);
+  if (files.empty()) {
+    std::cerr << "ERROR: no .json files found\n";
+    return 1;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  // one file per worker at a time, each with its own CPU and memory
+  auto results = std::vector<Result>(files.size());
+  auto next = std::atomic<size_t>{0};
+  auto jobs = options.jobs != 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+  jobs = std::min<unsigned>(jobs, static_cast<unsigned>(files.size()));
+
+  auto start = Clock::now();
+  {
+    auto workers = std::vector<std::thread>{};
+    for (auto i = 0u; i < jobs; ++i) {
+      workers.emplace_back([&] {
+        TRACE_THREAD("cputest");
+        for (auto n = next++; n < files.size(); n = next++) {
+          results[n] = RunFile(files[n], options);
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+  }
+  auto seconds = std::chrono::duration<double>{Clock::now() - start}.count();
+
+  auto width = std::string_view{"FILE"}.size();
+  for (auto const& file : files) width = std::max(width, file.name.size());
+  std::cout << std::left << std::setw(static_cast<int>(width)) << "FILE" << "  " << std::setw(12)
+            << "RESULT" << std::right << std::setw(10) << "CASES" << std::setw(12) << "HOST"
+            << '\n';
+
+  auto passed = std::uint64_t{0};
+  auto total = std::uint64_t{0};
+  auto all_passed = true;
+  for (auto i = size_t{0}; i < files.size(); ++i) {
+    auto const& result = results[i];
+    passed += result.passed;
+    total += result.passed + result.failed;
+    auto good = result.kind == Result::Kind::Pass || result.kind == Result::Kind::Skipped;
+    all_passed = all_passed && good;
+    if (good && !options.verbose) continue;
+
+    std::cout << std::left << std::setw(static_cast<int>(width)) << files[i].name << "  "
+              << std::setw(12) << Describe(result) << std::right << std::setw(10)
+              << result.passed + result.failed << std::fixed << std::setprecision(1)
+              << std::setw(9) << result.host_seconds * 1000.0 << " ms\n";
+    if (!result.error.empty()) std::cout << "    " << result.error << '\n';
+    for (auto const& failure : result.failures) std::cout << "    " << failure << '\n';
+  }
+
+  std::cout << '\n'
+            << passed << " of " << total << " cases in " << files.size() << " files passed in "
+            << std::fixed << std::setprecision(2) << seconds << " s (" << jobs
+            << (jobs == 1 ? " job" : " jobs") << ")\n";
+  return all_passed ? 0 : 1;
+}
+
+// ----------------------------------------------
+// Definitions
+// ----------------------------------------------
+
+void JsonReader::ReadString(std::string& out) {
+  Expect('"');
+  out.clear();
+  for (auto c = Get(); c != '"'; c = Get()) {
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    switch (c = Get()) {
+    case 'b': out += '\b'; break;
+    case 'f': out += '\f'; break;
+    case 'n': out += '\n'; break;
+    case 'r': out += '\r'; break;
+    case 't': out += '\t'; break;
+    case 'u': {
+      auto code = 0u;
+      for (auto i = 0; i < 4; ++i) {
+        auto digit = Get();
+        auto value = std::string_view{"0123456789abcdef"}.find(static_cast<char>(digit | 0x20));
+        if (value == std::string_view::npos) Fail("bad \\u escape");
+        code = code << 4 | static_cast<unsigned>(value);
+      }
+      // names are ASCII in practice; anything else only has to survive being printed
+      if (code < 0x80) {
+        out += static_cast<char>(code);
+      } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | code >> 6);
+        out += static_cast<char>(0x80 | (code & 0x3F));
+      } else {
+        out += static_cast<char>(0xE0 | code >> 12);
+        out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+      }
+      break;
+    }
+    default: out += c; break;  // \" \\ and \/
+    }
+  }
+}
+
+auto JsonReader::ReadInt() -> long long {
+  auto negative = Consume('-');
+  auto value = 0ll;
+  auto digits = 0;
+  for (;;) {
+    if (m_pos == m_end && !Refill()) break;
+    auto c = m_buffer[m_pos];
+    if (c < '0' || c > '9') break;
+    value = value * 10 + (c - '0');
+    ++digits;
+    ++m_pos;
+  }
+  if (digits == 0) Fail("expected an integer");
+  return negative ? -value : value;
+}
+
+void JsonReader::Skip() {
+  switch (Peek()) {
+  case '{': ForEachMember([this](std::string_view) { Skip(); }); break;
+  case '[': ForEachElement([this] { Skip(); }); break;
+  case '"': ReadString(m_skipped); break;
+  default: {
+    // numbers, true, false and null
+    auto length = 0;
+    for (;;) {
+      if (m_pos == m_end && !Refill()) break;
+      auto c = m_buffer[m_pos];
+      auto part = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' ||
+                  c == '.' || c == 'E';
+      if (!part) break;
+      ++length;
+      ++m_pos;
+    }
+    if (length == 0) Fail("expected a value");
+  }
+  }
+}
+
+auto FindFiles(Options const& options) -> std::vector<OpcodeFile> {
+  namespace fs = std::filesystem;
+
+  auto files = std::vector<OpcodeFile>{};
+  auto Add = [&](fs::path const& file, fs::path const& base) {
+    auto name = base.empty() ? file.filename() : file.lexically_relative(base);
+    auto opcode = -1;
+    auto stem = file.stem().string();
+    if (stem.size() == 2 && std::isxdigit(stem[0]) && std::isxdigit(stem[1])) {
+      opcode = std::stoi(stem, nullptr, 16);
+    }
+    files.push_back({name.generic_string(), file, opcode});
+  };
+
+  for (auto const& path : options.paths) {
+    auto error = std::error_code{};
+    if (fs::is_directory(path, error)) {
+      for (auto const& entry : fs::recursive_directory_iterator{path, error}) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+          Add(entry.path(), path);
+        }
+      }
+    } else {
+      Add(path, {});
+    }
+  }
+
+  std::sort(files.begin(), files.end(), [](auto const& a, auto const& b) {
+    return a.name < b.name;
+  });
+  return files;
+}
+
+auto RunFile(OpcodeFile const& file, Options const& options) -> Result {
+  using Clock = std::chrono::steady_clock;
+
+  auto result = Result{};
+  // the core throws on the unofficial opcodes rather than emulating them
+  if (!options.unofficial && file.opcode >= 0 &&
+      nes::optable[file.opcode].type == nes::OpType::Ill) {
+    result.kind = Result::Kind::Skipped;
+    return result;
+  }
+
+  auto start = Clock::now();
+  auto handle = std::unique_ptr<std::FILE, decltype(&std::fclose)>{
+      std::fopen(file.file.string().c_str(), "rb"), &std::fclose};
+  if (!handle) {
+    result.kind = Result::Kind::Error;
+    result.error = "can't open " + file.file.string();
+    return result;
+  }
+
+  auto bus = std::make_unique<nes::FlatBus>();
+  auto cpu = nes::Cpu{};
+  cpu.AttachBus(bus.get());
+
+  try {
+    auto json = JsonReader{handle.get()};
+    auto test = Case{};
+    json.ForEachElement([&] {
+      ReadCase(json, test);
+      auto failure = RunCase(cpu, *bus, test);
+      if (failure.empty()) {
+        ++result.passed;
+        return;
+      }
+      ++result.failed;
+      if (result.failures.size() < options.shown_failures) {
+        result.failures.push_back('"' + test.name + "\": " + failure);
+      }
+    });
+  } catch (std::exception& e) {
+    result.kind = Result::Kind::Error;
+    result.error = e.what();
+  }
+
+  if (result.kind != Result::Kind::Error && result.failed != 0) result.kind = Result::Kind::Fail;
+  result.host_seconds = std::chrono::duration<double>{Clock::now() - start}.count();
+  return result;
+}
+
+void ReadCase(JsonReader& json, Case& test) {
+  auto ReadSnapshot = [&](Snapshot& snapshot) {
+    snapshot.ram.clear();
+    json.ForEachMember([&](std::string_view key) {
+      auto& reg = snapshot.reg;
+      if (key == "pc") {
+        reg.pc = static_cast<addr_t>(json.ReadInt());
+      } else if (key == "s") {
+        reg.s = static_cast<byte_t>(json.ReadInt());
+      } else if (key == "a") {
+        reg.a = static_cast<byte_t>(json.ReadInt());
+      } else if (key == "x") {
+        reg.x = static_cast<byte_t>(json.ReadInt());
+      } else if (key == "y") {
+        reg.y = static_cast<byte_t>(json.ReadInt());
+      } else if (key == "p") {
+        reg.p = static_cast<byte_t>(json.ReadInt());
+      } else if (key == "ram") {
+        json.ForEachElement([&] {
+          json.Expect('[');
+          auto addr = static_cast<addr_t>(json.ReadInt());
+          json.Expect(',');
+          auto value = static_cast<byte_t>(json.ReadInt());
+          json.Expect(']');
+          snapshot.ram.emplace_back(addr, value);
+        });
+      } else {
+        json.Skip();
+      }
+    });
+  };
+
+  test.name.clear();
+  test.cycles = 0;
+  json.ForEachMember([&](std::string_view key) {
+    if (key == "name") {
+      json.ReadString(test.name);
+    } else if (key == "initial") {
+      ReadSnapshot(test.initial);
+    } else if (key == "final") {
+      ReadSnapshot(test.final);
+    } else if (key == "cycles") {
+      json.ForEachElement([&] {
+        json.Skip();
+        ++test.cycles;
+      });
+    } else {
+      json.Skip();
+    }
+  });
+}
+
+auto RunCase(nes::Cpu& cpu, nes::FlatBus& bus, Case const& test) -> std::string {
+  // longer than any instruction, in case one never finishes
+  constexpr auto max_cycles = size_t{16};
+
+  for (auto [addr, value] : test.initial.ram) bus.memory[addr] = value;
+  bus.writes.clear();
+
+  auto state = nes::Cpu::State{};
+  state.reg = test.initial.reg;
+  auto cycles = size_t{0};
+  auto failure = std::string{};
+  try {
+    cpu.LoadState(state);
+    do {
+      cpu.Step();
+      cpu.SaveState(state);
+      ++cycles;
+    } while (state.cycles != 0 && cycles < max_cycles);
+  } catch (std::exception& e) {
+    failure = e.what();
+  }
+
+  if (failure.empty()) {
+    auto Check = [&](char const* what, auto actual, auto expected) {
+      if (actual == expected) return;
+      if (!failure.empty()) failure += ", ";
+      failure += std::string{what} + " = " + nes::Hexify(actual) + ", expected " +
+                 nes::Hexify(expected);
+    };
+    auto const& reg = cpu.GetRegisters();
+    auto const& expected = test.final.reg;
+    Check("pc", reg.pc, expected.pc);
+    Check("s", reg.s, expected.s);
+    Check("a", reg.a, expected.a);
+    Check("x", reg.x, expected.x);
+    Check("y", reg.y, expected.y);
+    Check("p", reg.p, expected.p);
+    for (auto [addr, value] : test.final.ram) {
+      Check(("[" + nes::Hexify(addr) + "]").c_str(), bus.memory[addr], value);
+    }
+    for (auto addr : bus.writes) {
+      auto listed = std::any_of(test.final.ram.begin(), test.final.ram.end(),
+                                [&](auto const& entry) { return entry.first == addr; });
+      if (listed) continue;
+      if (!failure.empty()) failure += ", ";
+      failure += "stray write to " + nes::Hexify(addr);
+    }
+    if (cycles != test.cycles) {
+      if (!failure.empty()) failure += ", ";
+      failure += std::to_string(cycles) + " cycles, expected " + std::to_string(test.cycles);
+    }
+  }
+
+  // put memory back to all zeros for the next case
+  for (auto [addr, value] : test.initial.ram) bus.memory[addr] = 0;
+  for (auto [addr, value] : test.final.ram) bus.memory[addr] = 0;
+  for (auto addr : bus.writes) bus.memory[addr] = 0;
+  return failure;
+}
+
+auto Describe(Result const& result) -> std::string {
+  switch (result.kind) {
+  case Result::Kind::Pass: return "pass";
+  case Result::Kind::Fail: return "FAIL";
+  case Result::Kind::Skipped: return "unofficial";
+  case Result::Kind::Error: return "ERROR";
+  }
+  return "";
+}
+
+Options ParseArgs(int argc, char* argv[]) {
+  using namespace std::literals;
+
+  auto options = Options{};
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  auto IsFlag = [](auto it) { return it.front() == '-' && it.size() > 1; };
+
+  auto InvalidArgument = [&](std::string_view flag, std::string_view arg = ""sv) mutable {
+    options.print_help = true;
+    std::cerr << "Invalid argument to '" << flag;
+    if (arg.empty()) {
+      std::cerr << "'\n";
+      return;
+    } else {
+      std::cerr << "' : '" << arg << "'\n";
+    }
+  };
+
+  auto GetArgument = [&](auto flag, auto it) {
+    if (it == args.end() || IsFlag(*it)) {
+      options.print_help = true;
+      InvalidArgument(flag);
+      return ""sv;
+    }
+    return *it;
+  };
+
+  auto UnknownFlag = [&](std::string_view flag) mutable {
+    options.print_help = true;
+    std::cerr << "Unknown flag '" << flag << "'\n";
+  };
+
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (auto flag = *it; IsFlag(flag)) {
+      if (flag == "-h" || flag == "--help") {
+        options.print_help = true;
+        return options;
+      }
+      if (flag == "-v" || flag == "--verbose") {
+        options.verbose = true;
+        continue;
+      }
+      if (flag == "--unofficial") {
+        options.unofficial = true;
+        continue;
+      }
+
+      auto arg = GetArgument(flag, ++it);
+      if (arg.empty()) return options;
+
+      if (flag == "-j" || flag == "--jobs") {
+        options.jobs = static_cast<unsigned>(std::stoul(std::string{arg}));
+      } else if (flag == "--show") {
+        options.shown_failures = std::stoul(std::string{arg});
+      } else {
+        UnknownFlag(flag);
+        return options;
+      }
+    } else /* !IsFlag(it) */ {
+      options.paths.emplace_back(*it);
+    }
+  }
+  return options;
+}
+
+void PrintHelp() {
+  constexpr auto help = R"EOF(
+usage: renes-cputest [options] path...
+
+Runs the CPU core on its own against per-opcode single-step test vectors (the
+JSON files of SingleStepTests' nes6502 set, named 00.json to ff.json). Each
+case loads the registers and RAM it lists into a CPU on a flat 64 KiB bus, runs
+one instruction, and checks the registers, the RAM, that nothing else was
+written, and the number of cycles taken. Each path is a .json file or a
+directory searched recursively for them. Files for the unofficial opcodes,
+which the core doesn't emulate, are skipped. Exits with status 1 unless every
+case passes.
+
+options:
+  -h, --help              Prints this help message and exits.
+  -j, --jobs N            Runs N files at a time (default: one per hardware
+                          thread).
+      --show N            Describes the first N failing cases of each file
+                          (default 3).
+      --unofficial        Runs the unofficial opcodes' files as well.
+  -v, --verbose           Lists every file, not only the ones that failed.
+
+)EOF";
+
+  std::cout << help;
+}
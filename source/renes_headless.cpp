@@ -0,0 +1,458 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "nes/nes.hpp"
+
+struct Options {
+  bool print_help = false;
+  std::string log_file = "";
+  std::string trace_file = "";
+  std::string rom_file = "";
+  std::string frame_dump_file = "";
+  std::string ram_dump_file = "";
+  std::string audio_dump_file = "";
+  std::string capture_file = "";
+  std::string record_file = "";
+  std::string replay_file = "";
+  std::string bus_profile_prefix = "";
+  std::string record_hashes_file = "";
+  std::string verify_hashes_file = "";
+  std::uint64_t frames = 600;
+  std::uint64_t cycles = 0;
+  std::uint64_t stats_interval = 0;
+  unsigned run_ahead = 0;
+  nes::Console::Video video = nes::Console::Video::All;
+};
+
+void PrintHelp();
+Options ParseArgs(int argc, char* argv[]);
+
+auto DumpFrame(std::string const& file, nes::Display const& display) -> bool;
+void PrintStats(std::ostream& out, nes::PerfStats const& stats);
+auto DumpRam(std::string const& file, nes::Console const& console) -> bool;
+void WriteHashes(std::ostream& out, std::uint64_t frame, nes::Console::FrameHashes const& hashes);
+auto ReadHashLog(std::string const& file, std::vector<nes::Console::FrameHashes>& log) -> bool;
+auto CompareHashes(nes::Console::FrameHashes const& expected,
+                   nes::Console::FrameHashes const& actual) -> std::string;
+
+int main(int argc, char* argv[]) {
+  auto options = ParseArgs(argc, argv);
+  if (options.print_help || options.rom_file.empty()) {
+    PrintHelp();
+    return options.print_help ? 0 : 1;
+  }
+
+  if (!options.log_file.empty()) { LOG_FILE(options.log_file); }
+  TRACE_THREAD("main");
+
+  auto console = nes::Console{};
+  console.Reset();
+  console.Load(options.rom_file);
+  if (!console.GetCartridge().Valid()) {
+    std::cerr << "ERROR: could not load '" << options.rom_file << "'\n";
+    return 1;
+  }
+
+  console.SetRunAhead(options.run_ahead);
+  console.SetVideo(options.video);
+  console.EnableStats(options.stats_interval > 0);
+
+  auto replaying = !options.replay_file.empty();
+  if (replaying && !console.PlayMovie(options.replay_file)) {
+    std::cerr << "ERROR: could not replay '" << options.replay_file << "'\n";
+    return 1;
+  }
+  if (!options.record_file.empty()) console.StartRecording();
+
+  auto capturing = !options.capture_file.empty() || !options.audio_dump_file.empty();
+  if (capturing && !console.StartCapture(options.capture_file, options.audio_dump_file)) {
+    std::cerr << "ERROR: could not capture to '" << options.capture_file << "' / '"
+              << options.audio_dump_file << "'\n";
+    return 1;
+  }
+  // a capture streamed to standard output keeps it to itself
+  auto& report =
+      options.capture_file == "-" || options.audio_dump_file == "-" ? std::cerr : std::cout;
+
+  auto recording_hashes = !options.record_hashes_file.empty();
+  auto verifying_hashes = !options.verify_hashes_file.empty();
+  auto hash_log = std::ofstream{};
+  if (recording_hashes) {
+    hash_log.open(options.record_hashes_file);
+    if (!hash_log) {
+      std::cerr << "ERROR: could not write '" << options.record_hashes_file << "'\n";
+      return 1;
+    }
+    hash_log << "# renes frame hashes of " << options.rom_file
+             << "\n# frame display cpu ram vram oam\n";
+  }
+  auto golden = std::vector<nes::Console::FrameHashes>{};
+  if (verifying_hashes && !ReadHashLog(options.verify_hashes_file, golden)) {
+    std::cerr << "ERROR: could not read hashes from '" << options.verify_hashes_file << "'\n";
+    return 1;
+  }
+  // frameskip draws by host time, so hashes only repeat from run to run with every frame drawn
+  if (recording_hashes || verifying_hashes) console.SetVideo(nes::Console::Video::All);
+  auto divergence = std::string{};
+
+  using Clock = std::chrono::steady_clock;
+
+  auto frames = std::uint64_t{0};
+  auto start = Clock::now();
+  try {
+    // a replay runs for exactly as long as the movie
+    while ((replaying ? console.PlayingMovie() : options.frames == 0 || frames < options.frames) &&
+           (options.cycles == 0 || console.GetCycleCount() < options.cycles)) {
+      console.StepFrame();
+      ++frames;
+      if (options.stats_interval > 0 && frames % options.stats_interval == 0) {
+        PrintStats(report, console.GetStats());
+      }
+
+      if (recording_hashes || verifying_hashes) {
+        auto hashes = console.HashFrame();
+        if (recording_hashes) WriteHashes(hash_log, frames, hashes);
+        if (verifying_hashes) {
+          divergence = frames > golden.size() ? "the golden log ends before it"
+                                              : CompareHashes(golden[frames - 1], hashes);
+          if (!divergence.empty()) break;
+        }
+      }
+    }
+  } catch (std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << "\n";
+    return 1;
+  }
+  // the run isn't over until the capture has caught up
+  auto ok = console.StopCapture();
+  auto seconds = std::chrono::duration<double>{Clock::now() - start}.count();
+
+  auto cycles = console.GetCycleCount();
+  report << "frames:       " << frames << '\n';
+  report << "cycles:       " << cycles << '\n';
+  report << "seconds:      " << seconds << '\n';
+  report << "frames/sec:   " << frames / seconds << '\n';
+  report << "cycles/sec:   " << cycles / seconds << '\n';
+  report << "realtime:     " << (frames / seconds) / nes::FramePacer::ntsc_frame_rate << "x\n";
+  if (options.run_ahead > 0) {
+    report << "run-ahead:    " << console.GetRunAheadCost() << " us/frame\n";
+  }
+
+  if (verifying_hashes) {
+    if (!divergence.empty()) {
+      std::cerr << "MISMATCH: frame " << frames << " diverges from '"
+                << options.verify_hashes_file << "': " << divergence << '\n';
+      ok = false;
+    } else {
+      report << "hashes:       " << frames << " of " << golden.size() << " frames match\n";
+      if (frames != golden.size()) {
+        std::cerr << "MISMATCH: the run ended after " << frames << " frames, but '"
+                  << options.verify_hashes_file << "' has " << golden.size() << '\n';
+        ok = false;
+      }
+    }
+  }
+  if (recording_hashes) {
+    hash_log.close();
+    ok &= static_cast<bool>(hash_log);
+  }
+  if (!options.record_file.empty()) { ok &= console.StopRecording(options.record_file); }
+  if (!options.frame_dump_file.empty()) {
+    ok &= DumpFrame(options.frame_dump_file, console.GetDisplay());
+  }
+  if (!options.ram_dump_file.empty()) { ok &= DumpRam(options.ram_dump_file, console); }
+  if (!options.trace_file.empty()) { ok &= TRACE_DUMP(options.trace_file); }
+  if (!options.bus_profile_prefix.empty()) {
+    ok &= console.GetBusProfiler().WriteCsv(options.bus_profile_prefix);
+  }
+
+  return ok ? 0 : 1;
+}
+
+// ----------------------------------------------
+// Definitions
+// ----------------------------------------------
+
+auto DumpFrame(std::string const& file, nes::Display const& display) -> bool {
+  auto out = std::ofstream{file, std::ios::binary};
+  if (!out) {
+    std::cerr << "ERROR: could not write '" << file << "'\n";
+    return false;
+  }
+
+  auto [w, h] = nes::Display::Size();
+  out << "P6\n" << w << ' ' << h << "\n255\n";
+  out.write(reinterpret_cast<char const*>(display.GetRawPixelBuffer()), w * h * 3);
+  return static_cast<bool>(out);
+}
+
+void PrintStats(std::ostream& out, nes::PerfStats const& stats) {
+  auto flags = out.flags();
+  auto Ms = [](double ns) { return ns / 1e6; };
+  out << std::fixed << std::setprecision(3) << "stats: frame " << stats.frames << " | "
+      << std::setprecision(1) << stats.fps << " fps | " << stats.cycles << " cycles, "
+      << stats.instructions << " instructions | work " << std::setprecision(3)
+      << Ms(stats.work_ns) << " ms (cpu " << Ms(stats.cpu_ns) << ", ppu " << Ms(stats.ppu_ns)
+      << ", apu " << Ms(stats.apu_ns) << ", end of frame " << Ms(stats.end_frame_ns)
+      << ") | frame ms p50 " << stats.frame_ms_p50 << ", p90 " << stats.frame_ms_p90 << ", p99 "
+      << stats.frame_ms_p99 << ", max " << stats.frame_ms_max;
+  if (stats.host_counters) {
+    out << " | host ipc " << std::setprecision(2) << stats.host.Ipc() << " ("
+        << stats.host.instructions << " instructions, " << stats.host.cycles << " cycles), "
+        << stats.host.cache_misses << " cache misses, " << stats.host.branch_misses
+        << " branch misses";
+  }
+  out << '\n';
+  out.flags(flags);
+}
+
+auto DumpRam(std::string const& file, nes::Console const& console) -> bool {
+  auto out = std::ofstream{file, std::ios::binary};
+  if (!out) {
+    std::cerr << "ERROR: could not write '" << file << "'\n";
+    return false;
+  }
+
+  auto const& ram = console.GetRam();
+  out.write(reinterpret_cast<char const*>(ram.data()), ram.size());
+  return static_cast<bool>(out);
+}
+
+void WriteHashes(std::ostream& out, std::uint64_t frame, nes::Console::FrameHashes const& hashes) {
+  auto flags = out.flags();
+  out << std::dec << frame << std::hex << std::setfill('0');
+  for (auto hash : {hashes.display, hashes.cpu, hashes.ram, hashes.vram, hashes.oam}) {
+    out << ' ' << std::setw(16) << hash;
+  }
+  out << '\n';
+  out.flags(flags);
+}
+
+auto ReadHashLog(std::string const& file, std::vector<nes::Console::FrameHashes>& log) -> bool {
+  auto in = std::ifstream{file};
+  if (!in) return false;
+
+  auto line = std::string{};
+  while (std::getline(in, line)) {
+    if (line.empty() || line.front() == '#') continue;
+    auto fields = std::istringstream{line};
+    auto frame = std::uint64_t{0};
+    auto hashes = nes::Console::FrameHashes{};
+    fields >> std::dec >> frame >> std::hex >> hashes.display >> hashes.cpu >> hashes.ram >>
+        hashes.vram >> hashes.oam;
+    // frames are numbered from 1 and none may be missing
+    if (!fields || frame != log.size() + 1) {
+      std::cerr << "ERROR: '" << file << "' line " << log.size() + 1 << " is malformed\n";
+      return false;
+    }
+    log.push_back(hashes);
+  }
+  return true;
+}
+
+auto CompareHashes(nes::Console::FrameHashes const& expected,
+                   nes::Console::FrameHashes const& actual) -> std::string {
+  auto differences = std::string{};
+  auto count = 0;
+  auto Compare = [&](char const* name, std::uint64_t a, std::uint64_t b) {
+    if (a == b) return;
+    if (count++ > 0) differences += ", ";
+    differences += name;
+  };
+  Compare("display", expected.display, actual.display);
+  Compare("cpu", expected.cpu, actual.cpu);
+  Compare("ram", expected.ram, actual.ram);
+  Compare("vram", expected.vram, actual.vram);
+  Compare("oam", expected.oam, actual.oam);
+  if (count == 0) return differences;
+  return differences + (count == 1 ? " differs" : " differ");
+}
+
+Options ParseArgs(int argc, char* argv[]) {
+  using namespace std::literals;
+
+  auto options = Options{};
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  // a lone "-" is an argument: standard input or output
+  auto IsFlag = [](auto it) { return it.size() > 1 && it.front() == '-'; };
+
+  auto InvalidArgument = [&](std::string_view flag, std::string_view arg = ""sv) mutable {
+    options.print_help = true;
+    std::cerr << "Invalid argument to '" << flag;
+    if (arg.empty()) {
+      std::cerr << "'\n";
+      return;
+    } else {
+      std::cerr << "' : '" << arg << "'\n";
+    }
+  };
+
+  auto GetArgument = [&](auto flag, auto it) {
+    if (it == args.end() || IsFlag(*it)) {
+      options.print_help = true;
+      InvalidArgument(flag);
+      return ""sv;
+    }
+    return *it;
+  };
+
+  auto UnknownFlag = [&](std::string_view flag) mutable {
+    options.print_help = true;
+    std::cerr << "Unknown flag '" << flag << "'\n";
+  };
+
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (auto flag = *it; IsFlag(flag)) {
+      if (flag == "-h" || flag == "--help") {
+        options.print_help = true;
+        return options;
+      }
+
+      auto arg = GetArgument(flag, ++it);
+      if (arg.empty()) return options;
+
+      if (flag == "--log-level") {
+        // clang-format off
+        if (arg == "all") LOG_LEVEL(All);
+        else if (arg == "trace") LOG_LEVEL(Trace);
+        else if (arg == "debug") LOG_LEVEL(Debug);
+        else if (arg == "info") LOG_LEVEL(Info);
+        else if (arg == "warn") LOG_LEVEL(Warn);
+        else if (arg == "error") LOG_LEVEL(Error);
+        else if (arg == "none") LOG_LEVEL(None);
+        else InvalidArgument(flag, arg);
+        // clang-format on
+      } else if (flag == "--log-categories") {
+        if (auto mask = nes::ParseLogCategories(arg)) {
+          LOG_CATEGORIES(*mask);
+        } else {
+          InvalidArgument(flag, arg);
+        }
+      } else if (flag == "--log-file") {
+        options.log_file = arg;
+      } else if (flag == "--trace") {
+        options.trace_file = arg;
+      } else if (flag == "--frames") {
+        options.frames = std::stoull(std::string{arg}, nullptr, 0);
+      } else if (flag == "--cycles") {
+        options.cycles = std::stoull(std::string{arg}, nullptr, 0);
+      } else if (flag == "--video") {
+        // clang-format off
+        if (arg == "all") options.video = nes::Console::Video::All;
+        else if (arg == "frameskip") options.video = nes::Console::Video::Frameskip;
+        else if (arg == "none") options.video = nes::Console::Video::None;
+        else InvalidArgument(flag, arg);
+        // clang-format on
+      } else if (flag == "--stats") {
+        options.stats_interval = std::stoull(std::string{arg});
+      } else if (flag == "--run-ahead") {
+        options.run_ahead = std::stoul(std::string{arg});
+      } else if (flag == "--dump-frame") {
+        options.frame_dump_file = arg;
+      } else if (flag == "--dump-ram") {
+        options.ram_dump_file = arg;
+      } else if (flag == "--dump-audio") {
+        options.audio_dump_file = arg;
+      } else if (flag == "--capture") {
+        options.capture_file = arg;
+      } else if (flag == "--record") {
+        options.record_file = arg;
+      } else if (flag == "--replay") {
+        options.replay_file = arg;
+      } else if (flag == "--record-hashes") {
+        options.record_hashes_file = arg;
+      } else if (flag == "--verify-hashes") {
+        options.verify_hashes_file = arg;
+      } else if (flag == "--bus-profile") {
+        options.bus_profile_prefix = arg;
+      } else {
+        UnknownFlag(flag);
+        return options;
+      }
+    } else /* !IsFlag(it) */ {
+      if (options.rom_file.empty()) {
+        options.rom_file = *it;
+      } else {
+        std::cerr << *it << " is not a valid position argument\n";
+        options.print_help = true;
+        return options;
+      }
+    }
+  }
+  return options;
+}
+
+void PrintHelp() {
+  constexpr auto help = R"EOF(
+usage: renes-headless [options] rom
+
+Runs a ROM without any display as fast as possible, then reports emulation
+throughput.
+
+options:
+  -h, --help              Prints this help message and exits.
+      --log-file  FILE    Logs output to FILE instead of to the console.
+      --log-level LEVEL   Sets the logging level to LEVEL. Can be one of:
+                          'all', 'error', 'warn', 'info', 'debug', 'trace',
+                          or 'none'.
+      --log-categories LIST
+                          Limits debug and trace messages to the listed
+                          subsystems, separated by commas. Can include
+                          'cpu', 'ppu', 'bus', or 'all' (default).
+      --trace FILE        Writes a timeline of the run to FILE on exit, in
+                          Chrome trace-event format (for Perfetto or
+                          chrome://tracing). Needs a build configured with
+                          RENES_ENABLE_TRACING=ON.
+      --frames N          Stops after N frames (default 600). Use 0 for no
+                          frame limit.
+      --cycles N          Stops once N CPU cycles have run (checked at the
+                          end of each frame). Use 0 (default) for no limit.
+      --video MODE        Chooses which frames are drawn. Can be one of:
+                          'all' (default), 'frameskip' (about 60 per second
+                          of host time) or 'none' (RAM-only runs).
+      --stats N           Prints performance counters every N frames,
+                          including the host CPU's IPC, cache misses and
+                          branch misses where Linux allows reading them.
+      --run-ahead N       Runs N hidden frames ahead of every frame and
+                          reports their average cost per frame.
+      --dump-frame FILE   Writes the final frame to FILE as a binary PPM.
+      --dump-ram FILE     Writes the final 2 KiB of CPU RAM to FILE.
+      --dump-audio FILE   Writes all audio to FILE as a 48 kHz 16-bit WAV.
+      --capture FILE      Writes every frame to FILE as YUV4MPEG2 (4:2:0), for
+                          ffmpeg and most players. Draws every frame, whatever
+                          --video says. FILE (or the --dump-audio FILE) may be
+                          '-' for standard output, which moves this report to
+                          standard error.
+      --record FILE       Records the run as a movie in FILE.
+      --replay FILE       Replays the movie in FILE, running for as many
+                          frames as it holds (--frames is ignored).
+      --record-hashes FILE
+                          Writes hashes of every frame's picture, CPU
+                          registers, RAM, VRAM and OAM to FILE, one line per
+                          frame. Draws every frame, whatever --video says.
+      --verify-hashes FILE
+                          Checks every frame against the hashes in FILE,
+                          written earlier by --record-hashes, and stops at the
+                          first frame that differs, naming what differs. Use
+                          with the same --replay movie to check that a change
+                          to the core leaves a game's output as it was.
+      --bus-profile PREFIX
+                          Writes counts of every CPU bus access as CSV files
+                          named PREFIX.addresses.csv (per address),
+                          PREFIX.regions.csv (RAM, each PPU register, APU and
+                          I/O, PRG-RAM, PRG-ROM), PREFIX.banks.csv (reads per
+                          8 KiB PRG-ROM bank) and PREFIX.frames.csv (per
+                          region, per frame). Needs a build configured with
+                          RENES_ENABLE_BUS_PROFILER=ON.
+
+)EOF";
+
+  std::cout << help;
+}
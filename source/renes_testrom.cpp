@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "nes/nes.hpp"
+
+using nes::byte_t;
+
+struct Options {
+  bool print_help = false;
+  bool verbose = false;
+  unsigned jobs = 0;  // 0 for one per hardware thread
+  std::uint64_t cycles = 0;
+  std::string filter = "";
+  std::vector<std::string> paths = {};
+};
+
+// Test ROMs in the style of blargg's suites report through cartridge RAM: once $6001-$6003 hold
+// the signature DE B0 61, $6000 is $80 while the test runs, $81 when it wants the console reset,
+// and then the final result code - 0 for a pass. A NUL-terminated message follows from $6004.
+namespace status {
+constexpr nes::addr_t code = 0x6000;
+constexpr nes::addr_t signature = 0x6001;
+constexpr nes::addr_t text = 0x6004;
+constexpr nes::addr_t text_end = 0x8000;
+constexpr byte_t running = 0x80;
+constexpr byte_t reset_requested = 0x81;
+}  // namespace status
+
+// 60 seconds of NTSC CPU time, longer than any of the common suites' single tests take
+constexpr std::uint64_t default_cycles = 60 * 1'789'773;
+
+struct TestRom {
+  std::string name;  // relative to the directory it was found in
+  std::filesystem::path file;
+};
+
+struct Outcome {
+  enum class Kind { Pass, Fail, Timeout, NoStatus, LoadError, Error };
+
+  Kind kind = Kind::NoStatus;
+  int code = 0;
+  std::string text = "";
+  std::uint64_t cycles = 0;
+  double host_seconds = 0.0;
+};
+
+void PrintHelp();
+Options ParseArgs(int argc, char* argv[]);
+
+auto FindRoms(Options const& options) -> std::vector<TestRom>;
+auto RunRom(TestRom const& rom, std::uint64_t budget) -> Outcome;
+auto ReadText(nes::Cartridge const& cartridge) -> std::string;
+auto Describe(Outcome const& outcome) -> std::string;
+void PrintMatrix(std::vector<TestRom> const& roms, std::vector<Outcome> const& outcomes,
+                 Options const& options);
+
+int main(int argc, char* argv[]) {
+  auto options = ParseArgs(argc, argv);
+  if (options.print_help || options.paths.empty()) {
+    PrintHelp();
+    return options.print_help ? 0 : 1;
+  }
+  LOG_LEVEL(Warn);
+
+#if !defined(NDEBUG)
+  std::cerr << "WARNING: renes-testrom was built without optimizations (NDEBUG is not defined)\n";
+#endif
+
+  auto roms = FindRoms(options);
+  if (roms.empty()) {
+    std::cerr << "ERROR: no .nes files found\n";
+    return 1;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  // Every worker owns a whole console for the ROM it's running and takes the next ROM off a shared
+  // counter when it's done, so long tests don't hold up a fixed share of the list.
+  auto outcomes = std::vector<Outcome>(roms.size());
+  auto next = std::atomic<size_t>{0};
+  auto jobs = options.jobs != 0 ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+  jobs = std::min<unsigned>(jobs, static_cast<unsigned>(roms.size()));
+
+  auto start = Clock::now();
+  {
+    auto workers = std::vector<std::thread>{};
+    for (auto i = 0u; i < jobs; ++i) {
+      workers.emplace_back([&] {
+        TRACE_THREAD("testrom");
+        for (auto n = next++; n < roms.size(); n = next++) {
+          outcomes[n] = RunRom(roms[n], options.cycles != 0 ? options.cycles : default_cycles);
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+  }
+  auto seconds = std::chrono::duration<double>{Clock::now() - start}.count();
+
+  PrintMatrix(roms, outcomes, options);
+
+  auto passed = std::count_if(outcomes.begin(), outcomes.end(),
+                              [](auto const& o) { return o.kind == Outcome::Kind::Pass; });
+  std::cout << '\n'
+            << passed << " of " << roms.size() << " passed in " << std::fixed
+            << std::setprecision(2) << seconds << " s (" << jobs << (jobs == 1 ? " job" : " jobs")
+            << ")\n";
+  return static_cast<size_t>(passed) == roms.size() ? 0 : 1;
+}
+
+// ----------------------------------------------
+// Definitions
+// ----------------------------------------------
+
+auto FindRoms(Options const& options) -> std::vector<TestRom> {
+  namespace fs = std::filesystem;
+
+  auto roms = std::vector<TestRom>{};
+  auto Add = [&](fs::path const& file, fs::path const& base) {
+    auto name = base.empty() ? file.filename() : file.lexically_relative(base);
+    if (name.string().find(options.filter) == std::string::npos) return;
+    roms.push_back({name.generic_string(), file});
+  };
+
+  for (auto const& path : options.paths) {
+    auto error = std::error_code{};
+    if (fs::is_directory(path, error)) {
+      for (auto const& entry : fs::recursive_directory_iterator{path, error}) {
+        if (entry.is_regular_file() && entry.path().extension() == ".nes") Add(entry.path(), path);
+      }
+    } else {
+      Add(path, {});
+    }
+  }
+
+  std::sort(roms.begin(), roms.end(), [](auto const& a, auto const& b) { return a.name < b.name; });
+  return roms;
+}
+
+auto RunRom(TestRom const& rom, std::uint64_t budget) -> Outcome {
+  using Clock = std::chrono::steady_clock;
+  constexpr auto reset_delay = 6;  // frames; the protocol asks for at least 100 ms
+
+  auto outcome = Outcome{};
+  auto start = Clock::now();
+  try {
+    auto console = nes::Console{};
+    console.Reset();
+    console.SetPersistentSaves(false);
+    console.Load(rom.file.string());
+    if (!console.GetCartridge().Valid()) {
+      outcome.kind = Outcome::Kind::LoadError;
+      return outcome;
+    }
+    // the status lives in RAM, not on screen, and pixels are all that skipping drawing drops
+    console.SetVideo(nes::Console::Video::None);
+
+    auto const& cartridge = console.GetCartridge();
+    auto Peek = [&](nes::addr_t addr) { return cartridge.ReadProgramRam(addr); };
+
+    // A result only counts once this run has been seen in progress. The signature can land in RAM
+    // a frame before the running code does, and the zeroed byte under it would otherwise read as a
+    // pass.
+    auto seen_running = false;
+    auto reset_at = std::uint64_t{0};
+    auto frames = std::uint64_t{0};
+    while (console.GetCycleCount() < budget) {
+      console.StepFrame();
+      ++frames;
+
+      if (Peek(status::signature) != 0xDE || Peek(status::signature + 1) != 0xB0 ||
+          Peek(status::signature + 2) != 0x61) {
+        continue;
+      }
+
+      auto code = Peek(status::code);
+      if (code == status::running) {
+        seen_running = true;
+        outcome.kind = Outcome::Kind::Timeout;
+      } else if (code == status::reset_requested) {
+        seen_running = true;
+        outcome.kind = Outcome::Kind::Timeout;
+        if (reset_at == 0) reset_at = frames + reset_delay;
+        if (frames >= reset_at) {
+          reset_at = 0;
+          console.Reset();
+          console.Unpause();
+        }
+      } else if (code < status::running && seen_running) {
+        outcome.kind = code == 0 ? Outcome::Kind::Pass : Outcome::Kind::Fail;
+        outcome.code = code;
+        break;
+      }
+    }
+
+    outcome.cycles = console.GetCycleCount();
+    outcome.text = ReadText(cartridge);
+  } catch (std::exception& e) {
+    outcome.kind = Outcome::Kind::Error;
+    outcome.text = e.what();
+  }
+  outcome.host_seconds = std::chrono::duration<double>{Clock::now() - start}.count();
+  return outcome;
+}
+
+auto ReadText(nes::Cartridge const& cartridge) -> std::string {
+  auto text = std::string{};
+  for (auto addr = status::text; addr < status::text_end; ++addr) {
+    auto c = static_cast<char>(cartridge.ReadProgramRam(addr));
+    if (c == '\0') break;
+    text += c;
+  }
+  return text;
+}
+
+auto Describe(Outcome const& outcome) -> std::string {
+  switch (outcome.kind) {
+  case Outcome::Kind::Pass: return "pass";
+  case Outcome::Kind::Fail: return "FAIL #" + std::to_string(outcome.code);
+  case Outcome::Kind::Timeout: return "TIMEOUT";
+  case Outcome::Kind::NoStatus: return "NO STATUS";
+  case Outcome::Kind::LoadError: return "LOAD ERROR";
+  case Outcome::Kind::Error: return "ERROR";
+  }
+  return "";
+}
+
+void PrintMatrix(std::vector<TestRom> const& roms, std::vector<Outcome> const& outcomes,
+                 Options const& options) {
+  auto width = std::string_view{"ROM"}.size();
+  for (auto const& rom : roms) width = std::max(width, rom.name.size());
+
+  std::cout << std::left << std::setw(static_cast<int>(width)) << "ROM" << "  " << std::setw(10)
+            << "RESULT" << std::right << std::setw(12) << "EMULATED" << std::setw(12) << "HOST"
+            << std::setw(10) << "SPEED" << '\n';
+
+  for (auto i = size_t{0}; i < roms.size(); ++i) {
+    auto const& outcome = outcomes[i];
+    auto emulated = static_cast<double>(outcome.cycles) / nes::Apu::clock_rate;
+    std::cout << std::left << std::setw(static_cast<int>(width)) << roms[i].name << "  "
+              << std::setw(10) << Describe(outcome) << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << emulated << " s" << std::setw(9)
+              << outcome.host_seconds * 1000.0 << " ms" << std::setw(9) << std::setprecision(1)
+              << (outcome.host_seconds > 0.0 ? emulated / outcome.host_seconds : 0.0) << "x\n";
+
+    // failures say why in their text; passes only with --verbose
+    auto show_text = options.verbose || (outcome.kind != Outcome::Kind::Pass);
+    if (!show_text || outcome.text.empty()) continue;
+    auto text = std::string_view{outcome.text};
+    // the ROMs lay their text out for the screen; blank lines only pad out the matrix
+    while (!text.empty()) {
+      auto line = text.substr(0, text.find('\n'));
+      if (line.find_first_not_of(' ') != std::string_view::npos) {
+        std::cout << "    " << line << '\n';
+      }
+      text.remove_prefix(std::min(text.size(), line.size() + 1));
+    }
+  }
+}
+
+Options ParseArgs(int argc, char* argv[]) {
+  using namespace std::literals;
+
+  auto options = Options{};
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  auto IsFlag = [](auto it) { return it.front() == '-' && it.size() > 1; };
+
+  auto InvalidArgument = [&](std::string_view flag, std::string_view arg = ""sv) mutable {
+    options.print_help = true;
+    std::cerr << "Invalid argument to '" << flag;
+    if (arg.empty()) {
+      std::cerr << "'\n";
+      return;
+    } else {
+      std::cerr << "' : '" << arg << "'\n";
+    }
+  };
+
+  auto GetArgument = [&](auto flag, auto it) {
+    if (it == args.end() || IsFlag(*it)) {
+      options.print_help = true;
+      InvalidArgument(flag);
+      return ""sv;
+    }
+    return *it;
+  };
+
+  auto UnknownFlag = [&](std::string_view flag) mutable {
+    options.print_help = true;
+    std::cerr << "Unknown flag '" << flag << "'\n";
+  };
+
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (auto flag = *it; IsFlag(flag)) {
+      if (flag == "-h" || flag == "--help") {
+        options.print_help = true;
+        return options;
+      }
+      if (flag == "-v" || flag == "--verbose") {
+        options.verbose = true;
+        continue;
+      }
+
+      auto arg = GetArgument(flag, ++it);
+      if (arg.empty()) return options;
+
+      if (flag == "-j" || flag == "--jobs") {
+        options.jobs = static_cast<unsigned>(std::stoul(std::string{arg}));
+      } else if (flag == "--cycles") {
+        options.cycles = std::stoull(std::string{arg}, nullptr, 0);
+      } else if (flag == "--filter") {
+        options.filter = arg;
+      } else {
+        UnknownFlag(flag);
+        return options;
+      }
+    } else /* !IsFlag(it) */ {
+      options.paths.emplace_back(*it);
+    }
+  }
+  return options;
+}
+
+void PrintHelp() {
+  constexpr auto help = R"EOF(
+usage: renes-testrom [options] path...
+
+Runs test ROMs headlessly, several at once, and prints a pass/fail matrix with
+the emulated and host time each took. Each path is a .nes file or a directory
+searched recursively for them. ROMs report their result through the status
+protocol at $6000 used by blargg's test suites; ROMs that only show their
+result on screen come out as NO STATUS. Exits with status 1 unless every ROM
+passes.
+
+options:
+  -h, --help              Prints this help message and exits.
+  -j, --jobs N            Runs N ROMs at a time (default: one per hardware
+                          thread).
+      --cycles N          Gives up on a ROM after N CPU cycles (default
+                          107386380, one minute of emulated time).
+      --filter TEXT       Only runs ROMs whose path contains TEXT.
+  -v, --verbose           Prints every ROM's message, not only the messages
+                          of ROMs that didn't pass.
+
+)EOF";
+
+  std::cout << help;
+}